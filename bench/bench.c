@@ -0,0 +1,395 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "cpu.h"
+#include "import.h"
+#include "../day_1/c/calibration.h"
+#include "../day_2/c/cube_set.h"
+#include "../day_3/c/schematic.h"
+#include "../day_4/c/scratchcards.h"
+
+// timed runs of each part when -n isn't given
+#define DEFAULT_ITERATIONS 100
+
+// untimed runs of each part first so caches and branch predictors are warm
+#define WARMUP_ITERATIONS 5
+
+#define N_DAYS 4
+
+/// @brief input of one day and anything its parts need besides the text
+typedef struct BenchInput {
+    const char *path;   ///< file the input was mapped from
+    ImportView view;    ///< mapped input, buf is NULL if it couldn't be mapped
+    size_t width;       ///< width of the day 3 graph
+    GameLog games;      ///< day 2 games, built by build_cube_set for the parts after it
+} BenchInput;
+
+/// @brief a part function under test
+typedef struct BenchCase {
+    int day;                            ///< day the part belongs to
+    const char *name;                   ///< name of the part function
+    uint64_t (*run)(BenchInput *in);    ///< runs the part once, returns its answer
+} BenchCase;
+
+static uint64_t run_sum_document_part_one(BenchInput *in) {
+    return sum_document_part_one(in->view.buf, in->view.len);
+}
+
+static uint64_t run_sum_document_part_two(BenchInput *in) {
+    return sum_document_part_two(in->view.buf, in->view.len);
+}
+
+// both sums of the fused pass in one result, part one in the high half
+static uint64_t run_sum_document(BenchInput *in) {
+    Calibration cal = sum_document(in->view.buf, in->view.len);
+
+    return (uint64_t)cal.part_one << 32 | cal.part_two;
+}
+
+static uint64_t run_build_cube_set(BenchInput *in) {
+    clear_cube_set(&in->games);
+    build_cube_set(in->view.buf, in->view.len, &in->games);
+    return in->games.n_games;
+}
+
+static uint64_t run_audit_cube_set(BenchInput *in) {
+    return audit_cube_set(&in->games);
+}
+
+static uint64_t run_power_cube_set(BenchInput *in) {
+    return power_cube_set(&in->games);
+}
+
+static uint64_t run_sum(BenchInput *in) {
+    return sum(in->view.buf, in->view.len, in->width);
+}
+
+static uint64_t run_gear_ratio(BenchInput *in) {
+    return gear_ratio(in->view.buf, in->view.len, in->width);
+}
+
+static uint64_t run_evaluate_cards(BenchInput *in) {
+    return evaluate_cards(in->view.buf, in->view.len);
+}
+
+static uint64_t run_evaluate_cards_part_2(BenchInput *in) {
+    return evaluate_cards_part_2(in->view.buf, in->view.len);
+}
+
+/// @brief every part, build_cube_set must come before the day 2 parts that read its games
+static const BenchCase cases[] = {
+    { 1, "sum_document_part_one", run_sum_document_part_one },
+    { 1, "sum_document_part_two", run_sum_document_part_two },
+    { 1, "sum_document", run_sum_document },
+    { 2, "build_cube_set", run_build_cube_set },
+    { 2, "audit_cube_set", run_audit_cube_set },
+    { 2, "power_cube_set", run_power_cube_set },
+    { 3, "sum", run_sum },
+    { 3, "gear_ratio", run_gear_ratio },
+    { 4, "evaluate_cards", run_evaluate_cards },
+    { 4, "evaluate_cards_part_2", run_evaluate_cards_part_2 },
+};
+
+/// @brief nanoseconds on the monotonic clock
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/// @brief qsort order for uint64_t
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/// @brief nearest rank percentile of sorted samples
+static uint64_t percentile(const uint64_t *sorted, size_t n, size_t p) {
+    size_t rank = (n * p + 99) / 100;
+
+    return sorted[rank ? rank - 1 : 0];
+}
+
+/// @brief print a string as a JSON string
+static void print_json_string(const char *s) {
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            printf("\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            printf("\\u%04x", (unsigned char)*s);
+        else
+            putchar(*s);
+    }
+    putchar('"');
+}
+
+/// @brief time one part and print its result as a JSON object
+/// @param c part to run
+/// @param in input of the part's day
+/// @param iterations timed runs
+static void bench_case(const BenchCase *c, BenchInput *in, size_t iterations) {
+    uint64_t *samples;
+    uint64_t result = 0;
+    uint64_t total = 0;
+    uint64_t start;
+    double mean;
+    size_t i;
+
+    samples = calloc(iterations, sizeof(uint64_t));
+    if (samples == NULL) {
+        fprintf(stderr, "Out of memory!\n");
+        exit(1);
+    }
+
+    for (i = 0; i < WARMUP_ITERATIONS; i++)
+        result = c->run(in);
+
+    for (i = 0; i < iterations; i++) {
+        start = now_ns();
+        result = c->run(in);
+        samples[i] = now_ns() - start;
+        total += samples[i];
+    }
+
+    qsort(samples, iterations, sizeof(uint64_t), cmp_u64);
+    mean = (double)total / iterations;
+
+    printf("    {\"day\": %d, \"part\": ", c->day);
+    print_json_string(c->name);
+    printf(", \"input\": ");
+    print_json_string(in->path);
+    printf(", \"bytes\": %zu, \"result\": %lu, \"ns_per_op\": %.0f, \"mb_per_s\": %.2f"
+           ", \"p50_ns\": %lu, \"p99_ns\": %lu}",
+           in->view.len, (unsigned long)result, mean,
+           mean > 0 ? in->view.len * 1e3 / mean : 0.0,
+           (unsigned long)percentile(samples, iterations, 50),
+           (unsigned long)percentile(samples, iterations, 99));
+
+    free(samples);
+}
+
+/// @brief run every part with an input once
+/// @param inputs input of each day
+/// @param results answer of each part, parts without input are left alone
+static void answer_cases(BenchInput *inputs, uint64_t *results) {
+    size_t i;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        BenchInput *in = &inputs[cases[i].day - 1];
+
+        if (in->view.buf)
+            results[i] = cases[i].run(in);
+    }
+}
+
+/// @brief answer every part with this binary rerun under a lower AOC_CPU tier
+/// @param inputs input of each day, their paths are handed to the rerun
+/// @param tier tier to force
+/// @param results answer of each part, parts without input are left alone
+/// @return 0 on success, -1 if the rerun failed
+static int answer_cases_at(BenchInput *inputs, CpuTier tier, uint64_t *results) {
+    static const char *day_flags[N_DAYS] = { "-1", "-2", "-3", "-4" };
+    char *args[2 + 2 * N_DAYS + 1];
+    unsigned long result;
+    size_t i, n = 0;
+    int fds[2], status, d;
+    FILE *out;
+    pid_t pid;
+
+    args[n++] = "/proc/self/exe";
+    args[n++] = "-a";
+    for (d = 0; d < N_DAYS; d++) {
+        args[n++] = (char *)day_flags[d];
+        args[n++] = (char *)inputs[d].path;
+    }
+    args[n] = NULL;
+
+    if (pipe(fds) != 0)
+        return -1;
+
+    pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        setenv("AOC_CPU", cpu_tier_name(tier), 1);
+        execv(args[0], args);
+        _exit(127);
+    }
+
+    close(fds[1]);
+    out = fdopen(fds[0], "r");
+    assert(out);
+
+    // the rerun prints one answer per part with an input, in case order
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (inputs[cases[i].day - 1].view.buf == NULL)
+            continue;
+        if (fscanf(out, "%lu", &result) != 1)
+            break;
+        results[i] = result;
+    }
+
+    fclose(out);
+    waitpid(pid, &status, 0);
+
+    if (i < sizeof(cases) / sizeof(cases[0]) || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return -1;
+
+    return 0;
+}
+
+/// @brief compare every tier below the running one against it
+/// @param inputs input of each day
+/// @return 0 if every tier agrees, -1 otherwise
+static int check_tiers(BenchInput *inputs) {
+    uint64_t expect[sizeof(cases) / sizeof(cases[0])] = { 0 };
+    uint64_t got[sizeof(cases) / sizeof(cases[0])] = { 0 };
+    CpuTier top = cpu_tier();
+    int err = 0;
+    size_t i;
+    int t;
+
+    answer_cases(inputs, expect);
+
+    for (t = CPU_SCALAR; t < (int)top; t++) {
+        if (answer_cases_at(inputs, t, got) != 0) {
+            fprintf(stderr, "Couldn't rerun at tier %s!\n", cpu_tier_name(t));
+            return -1;
+        }
+
+        for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+            if (inputs[cases[i].day - 1].view.buf == NULL || got[i] == expect[i])
+                continue;
+            fprintf(stderr, "%s gives %lu at tier %s but %lu at tier %s!\n", cases[i].name,
+                    (unsigned long)got[i], cpu_tier_name(t), (unsigned long)expect[i], cpu_tier_name(top));
+            err = -1;
+        }
+    }
+
+    if (err == 0)
+        fprintf(stderr, "Tiers scalar to %s agree.\n", cpu_tier_name(top));
+
+    return err;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-a | -c | -n iterations] [-1 path] [-2 path] [-3 path] [-4 path]\n"
+                    "  -a prints each part's answer instead of timing it\n"
+                    "  -c checks every AOC_CPU tier the cpu supports gives the same answers\n", prog);
+}
+
+int main(int argc, char **argv) {
+    static const char *default_paths[N_DAYS] = {
+        "../day_1/c/input.txt",
+        "../day_2/c/input.txt",
+        "../day_3/c/input.txt",
+        "../day_4/c/input.txt",
+    };
+    BenchInput inputs[N_DAYS] = { { 0 } };
+    long iterations = DEFAULT_ITERATIONS;
+    bool answers = false, check = false;
+    bool first = true;
+    size_t i;
+    int d, opt;
+
+    for (d = 0; d < N_DAYS; d++)
+        inputs[d].path = default_paths[d];
+
+    while ((opt = getopt(argc, argv, "acn:1:2:3:4:")) != -1) {
+        switch (opt) {
+        case 'a':
+            answers = true;
+            break;
+        case 'c':
+            check = true;
+            break;
+        case 'n':
+            iterations = strtol(optarg, NULL, 10);
+            break;
+        case '1': case '2': case '3': case '4':
+            inputs[opt - '1'].path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (iterations <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // a day whose input is missing is left out of the report, not the whole run
+    for (d = 0; d < N_DAYS; d++) {
+        if (import_map(inputs[d].path, &inputs[d].view, IMPORT_HUGE_PAGES) <= 0) {
+            fprintf(stderr, "Skipping day %d, no input at %s!\n", d + 1, inputs[d].path);
+            import_unmap(&inputs[d].view);
+        }
+    }
+    if (inputs[2].view.buf)
+        inputs[2].width = graph_width(inputs[2].view.buf);
+
+    if (answers || check) {
+        uint64_t results[sizeof(cases) / sizeof(cases[0])] = { 0 };
+        int err = 0;
+
+        if (check) {
+            err = check_tiers(inputs);
+        } else {
+            answer_cases(inputs, results);
+            for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+                if (inputs[cases[i].day - 1].view.buf)
+                    printf("%lu\n", (unsigned long)results[i]);
+        }
+
+        free_cube_set(&inputs[1].games);
+        for (d = 0; d < N_DAYS; d++)
+            import_unmap(&inputs[d].view);
+
+        return err ? 1 : 0;
+    }
+
+    printf("{\n  \"cpu\": \"%s\",\n  \"iterations\": %ld,\n  \"warmup\": %d,\n  \"results\": [\n",
+           cpu_tier_name(cpu_tier()), iterations, WARMUP_ITERATIONS);
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        BenchInput *in = &inputs[cases[i].day - 1];
+
+        if (in->view.buf == NULL)
+            continue;
+
+        if (!first)
+            printf(",\n");
+        first = false;
+
+        bench_case(&cases[i], in, iterations);
+        fflush(stdout);
+    }
+
+    printf("\n  ]\n}\n");
+
+    free_cube_set(&inputs[1].games);
+    for (d = 0; d < N_DAYS; d++)
+        import_unmap(&inputs[d].view);
+
+    return 0;
+}
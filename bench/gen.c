@@ -0,0 +1,365 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// output is built up here and written in big pieces, inputs can run to many GB
+#define OUT_CAP (1 << 20)
+
+// widest day 3 row the generator writes
+#define ROW_MAX 65536
+
+/// @brief buffered stdout that keeps count of what was written
+typedef struct Out {
+    char buf[OUT_CAP];  ///< pending output
+    size_t len;         ///< bytes pending
+    uint64_t total;     ///< bytes written so far, pending included
+} Out;
+
+/// @brief knobs shared by every generator, what each one means depends on the day
+typedef struct GenOptions {
+    uint64_t seed;      ///< rng seed, the same seed always gives the same input
+    uint64_t count;     ///< lines, games, rows or cards to write
+    uint64_t bytes;     ///< if set, write whole units until at least this many bytes
+    double density;     ///< -d, see usage
+    long per;           ///< -k, see usage
+    long width;         ///< -w, see usage
+} GenOptions;
+
+static Out out;
+static uint64_t rng_state;
+
+/// @brief splitmix64, small and good enough for test data
+static uint64_t rng(void) {
+    uint64_t z = (rng_state += 0x9E3779B97F4A7C15ull);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/// @brief uniform value from 0 up to n
+static uint64_t rng_below(uint64_t n) {
+    return n ? rng() % n : 0;
+}
+
+/// @brief true with probability p
+static bool rng_chance(double p) {
+    return (rng() >> 11) * (1.0 / 9007199254740992.0) < p;
+}
+
+static void flush_out(void) {
+    if (out.len && fwrite(out.buf, 1, out.len, stdout) != out.len) {
+        fprintf(stderr, "Write error!\n");
+        exit(1);
+    }
+    out.len = 0;
+}
+
+static void put_bytes(const char *s, size_t n) {
+    if (out.len + n > OUT_CAP)
+        flush_out();
+    memcpy(out.buf + out.len, s, n);
+    out.len += n;
+    out.total += n;
+}
+
+static void put_str(const char *s) {
+    put_bytes(s, strlen(s));
+}
+
+/// @brief write v right aligned in width columns, no padding if width is 0
+static void put_uint(uint64_t v, int width) {
+    char tmp[24];
+    int n = 0;
+
+    do {
+        tmp[sizeof(tmp) - 1 - n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+
+    for (; n < width; n++)
+        tmp[sizeof(tmp) - 1 - n] = ' ';
+
+    put_bytes(tmp + sizeof(tmp) - n, n);
+}
+
+/// @brief number of decimal digits of v
+static int digits_of(uint64_t v) {
+    int n = 1;
+
+    for (; v >= 10; v /= 10)
+        n++;
+
+    return n;
+}
+
+/// @brief query if another unit should be written
+static bool more(const GenOptions *opt, uint64_t done) {
+    return opt->bytes ? out.total < opt->bytes : done < opt->count;
+}
+
+/// @brief day 1 calibration lines, letters with digits and spelled digits mixed in
+/// every line gets at least one ASCII digit so part one always has an answer
+static void gen_day_1(const GenOptions *opt) {
+    static const char *words[] = {
+        "zero", "one", "two", "three", "four", "five", "six", "seven", "eight", "nine",
+    };
+    long max_len = opt->width > 0 ? opt->width : 40;
+    uint64_t n, len, i, digit_at;
+
+    for (n = 0; more(opt, n); n++) {
+        len = 1 + rng_below(max_len);
+        digit_at = rng_below(len);
+
+        for (i = 0; i < len; i++) {
+            if (i == digit_at) {
+                put_uint(1 + rng_below(9), 0);
+            } else if (rng_chance(0.1)) {
+                if (rng_chance(opt->density))
+                    put_str(words[1 + rng_below(9)]);
+                else
+                    put_uint(1 + rng_below(9), 0);
+            } else {
+                char c = 'a' + rng_below(26);
+                put_bytes(&c, 1);
+            }
+        }
+        put_str("\n");
+    }
+}
+
+/// @brief day 2 game logs, each draw picks a non empty set of colors in any order
+/// draws stay within the part one limits except with probability density per color
+static void gen_day_2(const GenOptions *opt) {
+    static const char *colors[3] = { "red", "green", "blue" };
+    static const uint64_t limits[3] = { 12, 13, 14 };
+    long max_draws = opt->per > 0 ? opt->per : 6;
+    uint64_t n, draws, d, mask, cubes;
+    int order[3], i, j, t;
+
+    for (n = 0; more(opt, n); n++) {
+        put_str("Game ");
+        put_uint(n + 1, 0);
+        put_str(":");
+
+        draws = 1 + rng_below(max_draws);
+        for (d = 0; d < draws; d++) {
+            mask = 1 + rng_below(7);
+
+            // shuffle the colors so their order varies like in the puzzle
+            for (i = 0; i < 3; i++)
+                order[i] = i;
+            for (i = 2; i > 0; i--) {
+                j = rng_below(i + 1);
+                t = order[i], order[i] = order[j], order[j] = t;
+            }
+
+            for (i = 0, j = 0; i < 3; i++) {
+                if (!(mask & (1u << order[i])))
+                    continue;
+
+                cubes = rng_chance(opt->density)
+                    ? limits[order[i]] + 1 + rng_below(10)
+                    : 1 + rng_below(limits[order[i]]);
+
+                put_str(j++ ? ", " : " ");
+                put_uint(cubes, 0);
+                put_str(" ");
+                put_str(colors[order[i]]);
+            }
+            put_str(d + 1 < draws ? ";" : "\n");
+        }
+    }
+}
+
+/// @brief day 3 schematic, numbers of up to three digits and symbols scattered over dots
+/// density is the share of cells that start a symbol, per percent of those are gears
+static void gen_day_3(const GenOptions *opt) {
+    static const char symbols[] = "#$%&+-/=@";
+    long cols = opt->width > 0 ? opt->width : 140;
+    double gears = opt->per >= 0 ? opt->per / 100.0 : 0.3;
+    char row[ROW_MAX + 1];
+    long c, k, len;
+    uint64_t n;
+
+    if (cols > ROW_MAX) {
+        fprintf(stderr, "Rows can be at most %d wide!\n", ROW_MAX);
+        exit(1);
+    }
+
+    for (n = 0; more(opt, n); n++) {
+        for (c = 0; c < cols;) {
+            if (rng_chance(opt->density)) {
+                row[c++] = rng_chance(gears) ? '*' : symbols[rng_below(sizeof(symbols) - 1)];
+            } else if (rng_chance(0.1)) {
+                len = 1 + rng_below(3);
+                for (k = 0; k < len && c < cols; k++)
+                    row[c++] = (k == 0 ? '1' + rng_below(9) : '0' + rng_below(10));
+                // numbers are always followed by something that isn't a digit
+                if (c < cols)
+                    row[c++] = '.';
+            } else {
+                row[c++] = '.';
+            }
+        }
+        row[cols] = '\n';
+        put_bytes(row, cols + 1);
+    }
+}
+
+/// @brief query if v is one of the first n numbers of arr
+static bool has_number(const uint64_t *arr, long n, uint64_t v) {
+    for (long i = 0; i < n; i++) {
+        if (arr[i] == v)
+            return true;
+    }
+
+    return false;
+}
+
+/// @brief day 4 decks of right aligned fixed width columns, like the puzzle
+/// per winning and width tried numbers per card, each tried number is a winner with
+/// probability density and never otherwise. A card wins about density * width copies, part two
+/// totals stay bounded while that is under 1 and grow exponentially with the deck past it
+static void gen_day_4(const GenOptions *opt) {
+    long n_winners = opt->per > 0 ? opt->per : 10;
+    long n_tries = opt->width > 0 ? opt->width : 25;
+    int digits = 2;
+    uint64_t span, max_cards, n, v;
+    uint64_t *winners, *tries;
+    long i;
+    int id_width;
+
+    // numbers need room to stay distinct within a card
+    for (span = 99; span < (uint64_t)(n_winners + n_tries) * 2 && digits < 4; digits++)
+        span = span * 10 + 9;
+    if (span < (uint64_t)(n_winners + n_tries)) {
+        fprintf(stderr, "Too many numbers per card!\n");
+        exit(1);
+    }
+
+    // card ids are padded to one width so every card has the same layout
+    max_cards = opt->bytes
+        ? opt->bytes / (8 + (n_winners + n_tries) * (digits + 1)) + 1
+        : opt->count;
+    id_width = digits_of(max_cards);
+
+    winners = calloc(n_winners, sizeof(uint64_t));
+    tries = calloc(n_tries, sizeof(uint64_t));
+    if (winners == NULL || tries == NULL) {
+        fprintf(stderr, "Out of memory!\n");
+        exit(1);
+    }
+
+    for (n = 0; more(opt, n); n++) {
+        put_str("Card ");
+        put_uint(n + 1, id_width);
+        put_str(":");
+
+        for (i = 0; i < n_winners; i++) {
+            do {
+                v = 1 + rng_below(span);
+            } while (has_number(winners, i, v));
+            winners[i] = v;
+
+            put_str(" ");
+            put_uint(v, digits);
+        }
+        put_str(" |");
+
+        for (i = 0; i < n_tries; i++) {
+            // a winner that was already tried is swapped for a loser, losers are never winners
+            v = rng_chance(opt->density) ? winners[rng_below(n_winners)] : 0;
+            while (v == 0 || has_number(tries, i, v)) {
+                do {
+                    v = 1 + rng_below(span);
+                } while (has_number(winners, n_winners, v));
+            }
+            tries[i] = v;
+
+            put_str(" ");
+            put_uint(v, digits);
+        }
+        put_str("\n");
+    }
+
+    free(tries);
+    free(winners);
+}
+
+/// @brief parse a size like 512, 64K, 10M or 2G
+static uint64_t parse_size(const char *s) {
+    char *end;
+    uint64_t v = strtoull(s, &end, 10);
+
+    switch (*end) {
+    case 'G': case 'g': v <<= 10; // fall through
+    case 'M': case 'm': v <<= 10; // fall through
+    case 'K': case 'k': v <<= 10; break;
+    }
+
+    return v;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "usage: %s <day> [-s seed] [-n count] [-b size] [-d density] [-k per] [-w width]\n"
+        "  -b writes whole lines until size bytes, like 64K, 10M or 2G, instead of -n\n"
+        "  day 1: -n lines, -d chance a digit is spelled out, -w most characters and words per line\n"
+        "  day 2: -n games, -d chance a color breaks its limit, -k most draws per game\n"
+        "  day 3: -n rows, -d symbols per cell, -k percent of symbols that are gears, -w columns\n"
+        "  day 4: -n cards, -d chance a tried number wins, -k winning and -w tried numbers\n"
+        "         keep -d times -w under 1 or part two totals grow exponentially with -n\n",
+        prog);
+}
+
+int main(int argc, char **argv) {
+    GenOptions opt = {
+        .seed = 1,
+        .count = 1000,
+        .bytes = 0,
+        .density = -1,
+        .per = -1,
+        .width = -1,
+    };
+    static const double default_density[4] = { 0.3, 0.1, 0.05, 0.03 };
+    int day, c;
+
+    if (argc < 2 || (day = atoi(argv[1])) < 1 || day > 4) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    optind = 2;
+    while ((c = getopt(argc, argv, "s:n:b:d:k:w:")) != -1) {
+        switch (c) {
+        case 's': opt.seed = strtoull(optarg, NULL, 10); break;
+        case 'n': opt.count = strtoull(optarg, NULL, 10); break;
+        case 'b': opt.bytes = parse_size(optarg); break;
+        case 'd': opt.density = strtod(optarg, NULL); break;
+        case 'k': opt.per = strtol(optarg, NULL, 10); break;
+        case 'w': opt.width = strtol(optarg, NULL, 10); break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (opt.density < 0)
+        opt.density = default_density[day - 1];
+    rng_state = opt.seed;
+
+    switch (day) {
+    case 1: gen_day_1(&opt); break;
+    case 2: gen_day_2(&opt); break;
+    case 3: gen_day_3(&opt); break;
+    case 4: gen_day_4(&opt); break;
+    }
+
+    flush_out();
+
+    return 0;
+}
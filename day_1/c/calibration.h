@@ -0,0 +1,31 @@
+#ifndef AOC_CALIBRATION_H
+#define AOC_CALIBRATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief answers of both parts of a document
+typedef struct Calibration {
+    uint32_t part_one;  ///< sum over the first and last ASCII digit of each line
+    uint32_t part_two;  ///< sum over the first and last digit or digit word of each line
+} Calibration;
+
+/// @brief sum the first and last ASCII digit of every line
+/// @param doc lines of text, a final line without a newline is counted too
+/// @param count number of chars in doc
+/// @return sum
+uint32_t sum_document_part_one(const char* doc, size_t count);
+
+/// @brief sum the first and last digit or digit word of every line
+/// @param doc lines of text, a final line without a newline is counted too
+/// @param count number of chars in doc
+/// @return sum
+uint32_t sum_document_part_two(const char* doc, size_t count);
+
+/// @brief sum both parts of the encoded input doc in a single pass
+/// @param doc lines of text, a final line without a newline is counted too
+/// @param count number of chars in doc
+/// @return sums of both parts
+Calibration sum_document(const char* doc, size_t count);
+
+#endif // AOC_CALIBRATION_H
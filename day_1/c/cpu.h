@@ -0,0 +1,28 @@
+#ifndef AOC_CPU_H
+#define AOC_CPU_H
+
+// vector kernels are only built where the compiler can target each tier on demand
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_DISPATCH 1
+#endif
+
+/// @brief instruction set tiers the kernels are built for, each includes the ones before it
+typedef enum CpuTier {
+    CPU_SCALAR,     ///< plain C, the reference every other tier must agree with
+    CPU_SSE42,      ///< SSE4.2 and POPCNT
+    CPU_AVX2,       ///< AVX2 and BMI2
+    CPU_AVX512,     ///< AVX-512 F and BW
+    CPU_TIERS,
+} CpuTier;
+
+/// @brief query the best tier the running cpu supports
+/// AOC_CPU=scalar|sse4.2|avx2|avx512 forces a lower tier, the answer is worked out once
+/// @return tier to dispatch to
+CpuTier cpu_tier(void);
+
+/// @brief get the AOC_CPU name of a tier
+/// @param tier tier to name
+/// @return name
+const char *cpu_tier_name(CpuTier tier);
+
+#endif // AOC_CPU_H
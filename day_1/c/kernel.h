@@ -0,0 +1,169 @@
+// vector kernels of day 1, main.c includes this once per cpu tier
+// each copy is built under that tier's #pragma GCC target and named through KERNEL(name), the
+// ISA macros the pragma turns on pick the instructions of the copy
+
+/// @brief classify an aligned block into bitmasks, bit n is set when byte n matches
+/// @param p BLOCK_WIDTH aligned pointer
+/// @param digit set for '0' - '9'
+/// @param nl set for '\n'
+static inline void KERNEL(classify_block)(const char *p, uint64_t *digit, uint64_t *nl) {
+#if defined(__AVX512BW__)
+    __m512i x = _mm512_load_si512((const void *)p);
+
+    // c - '0' <= 9 unsigned is a digit
+    *digit = _mm512_cmple_epu8_mask(_mm512_sub_epi8(x, _mm512_set1_epi8('0')), _mm512_set1_epi8(9));
+    *nl = _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8('\n'));
+#elif defined(__AVX2__)
+    *digit = *nl = 0;
+    for (int i = 0; i < BLOCK_WIDTH; i += 32) {
+        __m256i x = _mm256_load_si256((const __m256i *)(p + i));
+        __m256i t = _mm256_sub_epi8(x, _mm256_set1_epi8('0'));
+
+        // c - '0' <= 9 unsigned is a digit
+        *digit |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(9)), t)) << i;
+        *nl |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n'))) << i;
+    }
+#else
+    *digit = *nl = 0;
+    for (int i = 0; i < BLOCK_WIDTH; i += 16) {
+        __m128i x = _mm_load_si128((const __m128i *)(p + i));
+        __m128i t = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+
+        // c - '0' <= 9 unsigned is a digit
+        *digit |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(9)), t)) << i;
+        *nl |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n'))) << i;
+    }
+#endif
+}
+
+/// @brief sum the encoded input doc, BLOCK_WIDTH bytes at a time
+/// the first and last digit of a line are the lowest and highest digit bits before its newline
+/// loads are aligned so reading past either end of doc never crosses into another page
+/// @param doc lines of text, a final line without a newline is counted too
+/// @param count number of chars in doc
+/// @return sum
+uint32_t KERNEL(sum_document_part_one)(const char* doc, size_t count) {
+    const char *p = (const char *)((uintptr_t)doc & ~(uintptr_t)(BLOCK_WIDTH - 1));
+    uint32_t skip = doc - p;
+    size_t left = count;
+    uint32_t sum = 0;
+    int32_t d1 = -1;
+    int32_t d2 = -1;
+    uint64_t digit, nl, live, before, seg;
+    bool done = false;
+
+    for (;; p += BLOCK_WIDTH) {
+        KERNEL(classify_block)(p, &digit, &nl);
+
+        // only look at the bytes of doc
+        live = ~(uint64_t)0 << skip;
+        if (left <= BLOCK_WIDTH - skip) {
+            if (skip + left < BLOCK_WIDTH)
+                live &= ((uint64_t)1 << (skip + left)) - 1;
+            done = true;
+        } else {
+            left -= BLOCK_WIDTH - skip;
+        }
+        skip = 0;
+        digit &= live;
+        nl &= live;
+
+        for (; nl; nl &= nl - 1) {
+            before = (nl & -nl) - 1;
+            seg = digit & before;
+            if (seg) {
+                if (d1 < 0) d1 = p[__builtin_ctzll(seg)] - '0';
+                d2 = p[63 - __builtin_clzll(seg)] - '0';
+            }
+            assert(d1 >= 0);
+
+            // without asserts a line with no digit adds nothing
+            if (d1 >= 0)
+                sum += d1 * 10 + d2;
+            d1 = d2 = -1;
+            digit &= ~before;
+        }
+
+        // digits of a line that continues into the next block
+        if (digit) {
+            if (d1 < 0) d1 = p[__builtin_ctzll(digit)] - '0';
+            d2 = p[63 - __builtin_clzll(digit)] - '0';
+        }
+
+        if (done)
+            break;
+    }
+
+    // a final line without a newline
+    if (d1 >= 0)
+        sum += d1 * 10 + d2;
+
+    return sum;
+}
+
+/// @brief sum both parts of the encoded input doc, BLOCK_WIDTH bytes at a time
+/// the bitmasks give the newline and the first and last ASCII digit of every line, so the
+/// automata of part two only see the letters at the ends of a line
+/// loads are aligned so reading past either end of doc never crosses into another page
+/// @param doc lines of text, a final line without a newline is counted too
+/// @param count number of chars in doc
+/// @return sums of both parts
+Calibration KERNEL(sum_document)(const char* doc, size_t count) {
+    const char *p = (const char *)((uintptr_t)doc & ~(uintptr_t)(BLOCK_WIDTH - 1));
+    uint32_t skip = doc - p;
+    size_t left = count;
+    Calibration cal = { 0, 0 };
+    const char *line = doc;
+    const char *first = NULL;
+    const char *last = NULL;
+    uint64_t digit, nl, live, before, seg;
+    bool done = false;
+
+    for (;; p += BLOCK_WIDTH) {
+        KERNEL(classify_block)(p, &digit, &nl);
+
+        // only look at the bytes of doc
+        live = ~(uint64_t)0 << skip;
+        if (left <= BLOCK_WIDTH - skip) {
+            if (skip + left < BLOCK_WIDTH)
+                live &= ((uint64_t)1 << (skip + left)) - 1;
+            done = true;
+        } else {
+            left -= BLOCK_WIDTH - skip;
+        }
+        skip = 0;
+        digit &= live;
+        nl &= live;
+
+        for (; nl; nl &= nl - 1) {
+            before = (nl & -nl) - 1;
+            seg = digit & before;
+            if (seg) {
+                if (first == NULL) first = p + __builtin_ctzll(seg);
+                last = p + 63 - __builtin_clzll(seg);
+            }
+
+            add_line(&cal, line, first, last, p + __builtin_ctzll(nl));
+            line = p + __builtin_ctzll(nl) + 1;
+            first = last = NULL;
+            digit &= ~before;
+        }
+
+        // digits of a line that continues into the next block
+        if (digit) {
+            if (first == NULL) first = p + __builtin_ctzll(digit);
+            last = p + 63 - __builtin_clzll(digit);
+        }
+
+        if (done)
+            break;
+    }
+
+    // a final line without a newline
+    if (line < doc + count)
+        add_line(&cal, line, first, last, doc + count);
+
+    return cal;
+}
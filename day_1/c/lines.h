@@ -0,0 +1,47 @@
+#ifndef AOC_LINES_H
+#define AOC_LINES_H
+
+#include <stddef.h>
+
+/// @brief where every line of a buffer starts, found once so solvers never hunt for newlines
+/// line i is start[i] up to start[i + 1], newline included. A final line without a newline
+/// is still a line, so start[n_lines] is always count
+typedef struct LineIndex {
+    const char *buf;    ///< indexed buffer
+    size_t count;       ///< number of chars in buf
+    size_t *start;      ///< offset of each line, n_lines + 1 entries
+    size_t n_lines;     ///< number of lines
+    size_t cap;         ///< entries start has room for
+} LineIndex;
+
+/// @brief index the lines of a buffer in one vectorized pass
+/// @param buf buffer to index, must stay alive as long as the index
+/// @param count number of chars in buf
+/// @param lines filled in, free with line_index_free
+/// @return number of lines
+size_t line_index_build(const char *buf, size_t count, LineIndex *lines);
+
+/// @brief free an index made by line_index_build
+/// @param lines index to free, zeroed afterwards
+void line_index_free(LineIndex *lines);
+
+/// @brief split the lines into shards of about the same number of bytes
+/// shard s is lines first[s] up to first[s + 1]
+/// @param lines built index
+/// @param n_shards most shards wanted
+/// @param min_bytes smallest shard worth making, fewer shards are made for small buffers
+/// @param first room for n_shards + 1 line numbers
+/// @return number of shards made, at least 1
+size_t line_index_shards(const LineIndex *lines, size_t n_shards, size_t min_bytes, size_t *first);
+
+/// @brief get the start of line i
+static inline const char *line_at(const LineIndex *lines, size_t i) {
+    return lines->buf + lines->start[i];
+}
+
+/// @brief get the length of line i, newline included
+static inline size_t line_length(const LineIndex *lines, size_t i) {
+    return lines->start[i + 1] - lines->start[i];
+}
+
+#endif // AOC_LINES_H
@@ -1,59 +1,48 @@
 #include <assert.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include "alloc.h"
+#include "calibration.h"
+#include "cpu.h"
+#include "import.h"
+#include "lines.h"
+#include "probe.h"
 
-/// @brief import a file to buffer
-/// this function allows querying file len when buf is NULL because it's not this function's
-/// job to alloc memory
-/// @param path path of file
-/// @param buf this is the buffer to file. If NULL the function just returns the file length
-/// @return file length
-ssize_t import(const char* path, char* buf) {
-    FILE* fp = NULL;
-    ssize_t fsize = -1;
+#ifdef CPU_DISPATCH
+#include <immintrin.h>
+#endif
 
-    fp = fopen(path, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "File import error!\n");
-        goto abort;
-    }
-
-    fseek(fp, 0L, SEEK_END);
-    fsize = ftell(fp);
-    if (fsize < 0) {
-        fprintf(stderr, "File read error!\n");
-        goto abort;
-    }
-    rewind(fp);
+// bytes classified per step of the vector kernels
+#define BLOCK_WIDTH 64
 
-    if (buf == NULL) {
-        goto abort;
-    }
+// smallest piece of input worth handing to its own thread
+#define SHARD_MIN (1 << 16)
 
-    if (fread(buf, sizeof(char), fsize, fp) != (size_t)fsize) {
-        fprintf(stderr, "Possible missing data!\n");
-    }
+// letters in the shortest digit word
+#define WORD_MIN 3
 
-abort:
-    fclose(fp);
-    return fsize;
-}
+/// @brief add one line to both sums, see its definition below the digit automata
+static void add_line(Calibration *cal, const char *line, const char *first, const char *last, const char *nl);
 
-/// @brief sum the encoded input doc
+/// @brief sum the encoded input doc, one byte at a time
 /// we know that it must be a two digit number which simplifies things
-/// @param doc str must be NULL terminated
+/// @param doc lines of text, a final line without a newline is counted too
+/// @param count number of chars in doc
 /// @return sum
-uint32_t sum_document_part_one(const char* doc) {
+uint32_t sum_document_part_one_scalar(const char* doc, size_t count) {
     uint32_t sum = 0;
     size_t i = 0;
     int32_t d1 = -1;
     int32_t d2 = -1;
     char c = '\0';
 
-    do {
+    for (i = 0; i < count; i++) {
         c = doc[i];
 
         if (isdigit(c)) {
@@ -62,89 +51,511 @@ uint32_t sum_document_part_one(const char* doc) {
         } else if (c == '\n') {
             assert(d1 >= 0);
 
-            d2 = d2 >= 0 ? d2 : d1;
-            sum += d1 * 10 + d2;
+            // without asserts a line with no digit adds nothing
+            if (d1 >= 0) {
+                d2 = d2 >= 0 ? d2 : d1;
+                sum += d1 * 10 + d2;
+            }
             d1 = d2 = -1;
         }
+    }
 
-        i++;
-    } while (c);
+    // a final line without a newline
+    if (d1 >= 0) {
+        d2 = d2 >= 0 ? d2 : d1;
+        sum += d1 * 10 + d2;
+    }
 
     return sum;
 }
 
+#ifdef CPU_DISPATCH
+#pragma GCC push_options
+#pragma GCC target("sse4.2,popcnt")
+#define KERNEL(name) name##_sse42
+#include "kernel.h"
+#undef KERNEL
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2,bmi,bmi2,popcnt")
+#define KERNEL(name) name##_avx2
+#include "kernel.h"
+#undef KERNEL
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx2,bmi,bmi2,popcnt")
+#define KERNEL(name) name##_avx512
+#include "kernel.h"
+#undef KERNEL
+#pragma GCC pop_options
+#endif
+
+Calibration sum_document_scalar(const char* doc, size_t count);
+
+/// @brief kernels of the running cpu's tier, picked before main runs
+static uint32_t (*part_one_kernel)(const char *, size_t) = sum_document_part_one_scalar;
+static Calibration (*both_parts_kernel)(const char *, size_t) = sum_document_scalar;
+
+/// @brief point the kernels at the best tier the cpu has, AOC_CPU can force a lower one
+__attribute__((constructor))
+static void select_kernels(void) {
+#ifdef CPU_DISPATCH
+    switch (cpu_tier()) {
+    case CPU_AVX512:
+        part_one_kernel = sum_document_part_one_avx512;
+        both_parts_kernel = sum_document_avx512;
+        break;
+    case CPU_AVX2:
+        part_one_kernel = sum_document_part_one_avx2;
+        both_parts_kernel = sum_document_avx2;
+        break;
+    case CPU_SSE42:
+        part_one_kernel = sum_document_part_one_sse42;
+        both_parts_kernel = sum_document_sse42;
+        break;
+    default:
+        break;
+    }
+#endif
+}
 
 /// @brief sum the encoded input doc
-/// in part two we must consider 'one' 'two' ... 'nine' as valid numbers
-/// @param doc str must be NULL terminated
+/// runs the vector kernel of the cpu's tier, the scalar path is the reference
+/// @param doc lines of text, a final line without a newline is counted too
+/// @param count number of chars in doc
 /// @return sum
-uint32_t sum_document_part_two(const char* doc) {
-    uint32_t sum = 0;
-    size_t i = 0;
-    size_t j = 0;
-    int32_t d1 = -1;
-    int32_t d2 = -1;
-    char c = '\0';
+uint32_t sum_document_part_one(const char* doc, size_t count) {
+    return part_one_kernel(doc, count);
+}
 
-    const char *digits[] = {
-        "zero",
-        "one",
-        "two",
-        "three",
-        "four",
-        "five",
-        "six",
-        "seven",
-        "eight",
-        "nine",
-    };
-
-    do {
-        c = doc[i];
+// upper bounds for the digit automata, checked when they are built
+#define DFA_STATES 64
+#define DFA_CLASSES 32
 
-        if (isdigit(c)) {
-            if (d1 < 0) d1 = c - '0';
-            else        d2 = c - '0';
-        } else if (c == '\n') {
-            assert(d1 >= 0);
+/// @brief table driven Aho-Corasick automaton over the spelled and ASCII digits
+/// bytes are first folded into a small set of classes so the transition table stays tiny
+typedef struct Automaton {
+    uint8_t cls[256];                       ///< byte to input class, 0 for bytes in no word
+    uint8_t next[DFA_STATES][DFA_CLASSES];  ///< complete transition table
+    int8_t out[DFA_STATES];                 ///< digit matched on entering a state, -1 for none
+} Automaton;
 
-            d2 = d2 >= 0 ? d2 : d1;
-            sum += d1 * 10 + d2;
+/// @brief words matched in part two, index is the value
+static const char *digit_words[] = {
+    "zero",
+    "one",
+    "two",
+    "three",
+    "four",
+    "five",
+    "six",
+    "seven",
+    "eight",
+    "nine",
+};
 
-            d1 = d2 = -1;
+static Automaton forward;   ///< matches words left to right
+static Automaton backward;  ///< matches reversed words right to left
+
+/// @brief build an automaton over every digit word and its ASCII digit
+/// @param dfa automaton to fill in
+/// @param reverse build over the reversed words for scanning backwards
+static void build_automaton(Automaton *dfa, bool reverse) {
+    uint8_t fail[DFA_STATES] = { 0 };
+    uint8_t queue[DFA_STATES];
+    bool child[DFA_STATES][DFA_CLASSES] = { { false } };
+    uint8_t n_states = 1;
+    uint8_t n_classes = 1;
+    size_t head = 0, tail = 0;
+    size_t i, j, len;
+    uint8_t s, c, t;
+    char word[8];
+
+    memset(dfa, 0, sizeof(*dfa));
+    memset(dfa->out, -1, sizeof(dfa->out));
+
+    // insert the words into a trie, states are allocated in insertion order
+    for (i = 0; i < 20; i++) {
+        if (i < 10) {
+            len = strlen(digit_words[i]);
+            for (j = 0; j < len; j++)
+                word[j] = digit_words[i][reverse ? len - 1 - j : j];
         } else {
-            for (j = 0; j < 10; j++) {
-                if (strncmp(doc + i, digits[j], strlen(digits[j])) == 0) {
-                    if (d1 < 0) d1 = j;
-                    else        d2 = j;
-                    break;
-                }
+            len = 1;
+            word[0] = '0' + (i - 10);
+        }
+
+        s = 0;
+        for (j = 0; j < len; j++) {
+            uint8_t b = (uint8_t)word[j];
+            if (dfa->cls[b] == 0)
+                dfa->cls[b] = n_classes++;
+            c = dfa->cls[b];
+            assert(n_classes <= DFA_CLASSES);
+
+            if (!child[s][c]) {
+                assert(n_states < DFA_STATES);
+                child[s][c] = true;
+                dfa->next[s][c] = n_states++;
+            }
+            s = dfa->next[s][c];
+        }
+        dfa->out[s] = i % 10;
+    }
+
+    // breadth first fill of the missing edges through the failure links
+    for (c = 0; c < n_classes; c++) {
+        if (child[0][c])
+            queue[tail++] = dfa->next[0][c];
+    }
+
+    while (head < tail) {
+        s = queue[head++];
+        for (c = 0; c < n_classes; c++) {
+            if (!child[s][c]) {
+                dfa->next[s][c] = dfa->next[fail[s]][c];
+                continue;
+            }
+
+            t = dfa->next[s][c];
+            fail[t] = dfa->next[fail[s]][c];
+            if (dfa->out[t] < 0)
+                dfa->out[t] = dfa->out[fail[t]];
+            queue[tail++] = t;
+        }
+    }
+}
+
+/// @brief build both automata before main runs
+__attribute__((constructor))
+static void build_digit_automata(void) {
+    build_automaton(&forward, false);
+    build_automaton(&backward, true);
+}
+
+/// @brief find the first digit word of a span
+/// @param p first char of the span
+/// @param end char after the span
+/// @return digit of the word or -1 if there is none
+static int32_t first_word(const char *p, const char *end) {
+    uint8_t state = 0;
+
+    for (; p < end; p++) {
+        state = forward.next[state][forward.cls[(uint8_t)*p]];
+        if (forward.out[state] >= 0)
+            return forward.out[state];
+    }
+
+    return -1;
+}
+
+/// @brief find the last digit word of a span
+/// @param begin first char of the span
+/// @param p char after the span
+/// @return digit of the word or -1 if there is none
+static int32_t last_word(const char *begin, const char *p) {
+    uint8_t state = 0;
+
+    while (p > begin) {
+        p--;
+        state = backward.next[state][backward.cls[(uint8_t)*p]];
+        if (backward.out[state] >= 0)
+            return backward.out[state];
+    }
+
+    return -1;
+}
+
+/// @brief add one line to both sums from where its first and last ASCII digit are
+/// a word can only come before the first or after the last ASCII digit, so only those ends of
+/// the line are matched and not at all when they are too short to hold a word
+/// @param cal sums of both parts
+/// @param line first char of the line
+/// @param first first ASCII digit of the line
+/// @param last last ASCII digit of the line
+/// @param nl newline of the line, or the end of doc for a final line without one
+static void add_line(Calibration *cal, const char *line, const char *first, const char *last, const char *nl) {
+    int32_t w1 = -1;
+    int32_t w2 = -1;
+
+    assert(first && last);
+
+    // without asserts a line with no ASCII digit still counts for part two if it has a word
+    if (first == NULL) {
+        w1 = first_word(line, nl);
+        if (w1 >= 0)
+            cal->part_two += w1 * 10 + last_word(line, nl);
+        return;
+    }
+
+    if (first - line >= WORD_MIN)
+        w1 = first_word(line, first);
+    if (nl - last > WORD_MIN)
+        w2 = last_word(last + 1, nl);
+
+    cal->part_one += (first[0] - '0') * 10 + (last[0] - '0');
+    cal->part_two += (w1 >= 0 ? w1 : first[0] - '0') * 10 + (w2 >= 0 ? w2 : last[0] - '0');
+}
+
+/// @brief sum the encoded input doc
+/// in part two we must consider 'one' 'two' ... 'nine' as valid numbers
+/// each line is matched forwards until the first digit, then backwards from its newline until
+/// the last one, so the middle of a line is never looked at. No word contains another so the
+/// first match ending and the first match starting are the same word, overlaps like "eightwo"
+/// fall out of the automaton for free
+/// @param doc lines of text, a final line without a newline is counted too
+/// @param count number of chars in doc
+/// @return sum
+uint32_t sum_document_part_two(const char* doc, size_t count) {
+    const char *p = doc;
+    const char *end = doc + count;
+    const char *line, *nl;
+    uint32_t sum = 0;
+    uint8_t state;
+    int32_t d1, d2;
+
+    while (p < end) {
+        // first digit
+        line = p;
+        d1 = -1;
+        state = 0;
+        for (; p < end && *p != '\n'; p++) {
+            state = forward.next[state][forward.cls[(uint8_t)*p]];
+            if (forward.out[state] >= 0) {
+                d1 = forward.out[state];
+                break;
             }
         }
 
-        i++;
-    } while (c);
+        // a final line without a newline ends at the end of doc
+        nl = memchr(p, '\n', end - p);
+        if (nl == NULL)
+            nl = end;
+        assert(d1 >= 0);
+
+        // last digit, there is always one since the first digit is a candidate, the start of the
+        // line bounds the scan all the same
+        d2 = -1;
+        state = 0;
+        for (p = nl; p > line && d2 < 0;) {
+            p--;
+            state = backward.next[state][backward.cls[(uint8_t)*p]];
+            d2 = backward.out[state];
+        }
+
+        // without asserts a line with no digit adds nothing
+        if (d1 >= 0)
+            sum += d1 * 10 + d2;
+        p = nl < end ? nl + 1 : end;
+    }
 
     return sum;
 }
 
-int main(void) {
-    char *buf = NULL;
+/// @brief sum both parts of the encoded input doc in a single pass, one byte at a time
+/// part two's automata run alongside part one's digit tracking, each line is walked forwards
+/// until both first digits are known and backwards from its newline until both last digits
+/// are, so every line is only pulled from memory once
+/// @param doc lines of text, a final line without a newline is counted too
+/// @param count number of chars in doc
+/// @return sums of both parts
+Calibration sum_document_scalar(const char* doc, size_t count) {
+    Calibration cal = { 0, 0 };
+    const char *p = doc;
+    const char *end = doc + count;
+    const char *line, *nl;
+    uint8_t state;
+    int32_t d1, d2, w1, w2;
+
+    while (p < end) {
+        // first digits, a word can only come before an ASCII digit so w1 is known once d1 is
+        line = p;
+        d1 = w1 = -1;
+        state = 0;
+        for (; p < end && *p != '\n' && d1 < 0; p++) {
+            state = forward.next[state][forward.cls[(uint8_t)*p]];
+            if (w1 < 0)
+                w1 = forward.out[state];
+            if (isdigit(*p))
+                d1 = *p - '0';
+        }
+
+        // a final line without a newline ends at the end of doc
+        nl = memchr(p, '\n', end - p);
+        if (nl == NULL)
+            nl = end;
+        assert(d1 >= 0);
+
+        // last digits, same again from the other end, never past the start of the line
+        d2 = w2 = -1;
+        state = 0;
+        for (p = nl; p > line && d2 < 0;) {
+            p--;
+            state = backward.next[state][backward.cls[(uint8_t)*p]];
+            if (w2 < 0)
+                w2 = backward.out[state];
+            if (isdigit(*p))
+                d2 = *p - '0';
+        }
+
+        // without asserts a line with no digit adds nothing to that part
+        if (d1 >= 0)
+            cal.part_one += d1 * 10 + d2;
+        if (w1 >= 0)
+            cal.part_two += w1 * 10 + w2;
+        p = nl < end ? nl + 1 : end;
+    }
+
+    return cal;
+}
+
+/// @brief sum both parts of the encoded input doc in a single pass
+/// runs the vector kernel of the cpu's tier, the scalar path is the reference
+/// @param doc lines of text, a final line without a newline is counted too
+/// @param count number of chars in doc
+/// @return sums of both parts
+Calibration sum_document(const char* doc, size_t count) {
+    return both_parts_kernel(doc, count);
+}
+
+/// @brief sum both parts line by line so any size of input runs in fixed memory
+/// @param stream open stream
+/// @param cal sums of both parts
+/// @return 0 on success or -1 on read error
+int sum_document_stream(ImportStream *stream, Calibration *cal) {
+    Calibration line_cal;
+    const char *line;
     ssize_t len;
 
-    len = import("input.txt", NULL);
-    assert(len > 0);
-    buf = calloc(len + 1, sizeof(char));
-    assert(buf);
+    *cal = (Calibration){ 0, 0 };
 
-    import("input.txt", buf);
+    while ((len = import_stream_line(stream, &line)) > 0) {
+        line_cal = sum_document(line, len);
+        cal->part_one += line_cal.part_one;
+        cal->part_two += line_cal.part_two;
+    }
+
+    return len < 0 ? -1 : 0;
+}
+
+/// @brief piece of the document summed by one thread
+typedef struct Shard {
+    const char *doc;    ///< first line of the shard
+    size_t count;       ///< number of chars, ends on a newline unless it is the last shard
+    Calibration cal;    ///< sums of the shard
+} Shard;
+
+/// @brief thread entry, sums both parts of one shard
+static void *sum_shard(void *arg) {
+    Shard *shard = arg;
+
+    shard->cal = sum_document(shard->doc, shard->count);
+
+    return NULL;
+}
+/// @brief query how many threads to run, AOC_THREADS overrides the number of cores
+/// @return thread count, at least 1
+size_t thread_count(void) {
+    const char *env = getenv("AOC_THREADS");
+    long n = env ? strtol(env, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+
+    return n > 0 ? (size_t)n : 1;
+}
+
+/// @brief sum both parts with the doc split into one shard per thread
+/// shards are whole lines of the index so every line is summed by exactly one thread
+/// @param lines index of the doc, a final line without a newline is counted too
+/// @param n_threads threads to use, fewer are used when the doc is small
+/// @return sums of both parts
+Calibration sum_document_parallel(const LineIndex *lines, size_t n_threads) {
+    Calibration cal;
+    Shard *shards;
+    pthread_t *threads;
+    size_t *first;
+    size_t i;
+    int err;
+
+    first = calloc(n_threads + 1, sizeof(*first));
+    assert(first);
+    n_threads = line_index_shards(lines, n_threads, SHARD_MIN, first);
+
+    shards = calloc(n_threads, sizeof(*shards));
+    threads = calloc(n_threads, sizeof(*threads));
+    assert(shards && threads);
+
+    for (i = 0; i < n_threads; i++) {
+        shards[i] = (Shard){
+            .doc = lines->buf + lines->start[first[i]],
+            .count = lines->start[first[i + 1]] - lines->start[first[i]],
+        };
+    }
 
-    uint32_t sum = sum_document_part_one(buf);
-    printf("Part 1 sum: %d\n", sum);
+    // the calling thread takes the first shard
+    for (i = 1; i < n_threads; i++) {
+        err = pthread_create(&threads[i], NULL, sum_shard, &shards[i]);
+        assert(err == 0);
+    }
+    sum_shard(&shards[0]);
+
+    cal = shards[0].cal;
+    for (i = 1; i < n_threads; i++) {
+        pthread_join(threads[i], NULL);
+        cal.part_one += shards[i].cal.part_one;
+        cal.part_two += shards[i].cal.part_two;
+    }
+
+    free(threads);
+    free(shards);
+    free(first);
+
+    return cal;
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "input.txt";
+    ImportView view;
+    ImportStream stream;
+    LineIndex lines;
+    ssize_t len;
+    Calibration cal;
+    int err;
+
+    if (import_is_file(path)) {
+        PROBE_BEGIN("import");
+        len = import_map(path, &view, IMPORT_HUGE_PAGES);
+        PROBE_END("import");
+        assert(len > 0);
+
+        PROBE_BEGIN("index");
+        line_index_build(view.buf, len, &lines);
+        PROBE_END("index");
+
+        PROBE_BEGIN("solve");
+        cal = sum_document_parallel(&lines, thread_count());
+        PROBE_END("solve");
+
+        line_index_free(&lines);
+        import_unmap(&view);
+    } else {
+        // pipes and stdin can't be mapped so read them a line at a time
+        PROBE_BEGIN("import");
+        err = import_stream_open(path, &stream, 0);
+        PROBE_END("import");
+        assert(err == 0);
+
+        PROBE_BEGIN("stream");
+        err = sum_document_stream(&stream, &cal);
+        PROBE_END("stream");
+
+        import_stream_close(&stream);
+        if (err)
+            return 1;
+    }
 
-    sum = sum_document_part_two(buf);
-    printf("Part 2 sum: %d\n", sum);
+    printf("Part 1 sum: %d\n", cal.part_one);
+    printf("Part 2 sum: %d\n", cal.part_two);
 
-    free(buf);
     return 0;
 }
@@ -0,0 +1,33 @@
+#ifndef AOC_ALLOC_H
+#define AOC_ALLOC_H
+
+/// @brief opt in tracking of every heap allocation, include after <stdlib.h>
+/// built with AOC_ALLOC_TRACK (make ALLOC=1) malloc, calloc, realloc and free of any file that
+/// includes this header go through counting wrappers that remember the file and line of each
+/// call. At exit the totals, peak live bytes, peak RSS and the hottest call sites are printed to
+/// stderr. Without AOC_ALLOC_TRACK this header does nothing
+#ifdef AOC_ALLOC_TRACK
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/// @brief malloc that records its call site
+void *alloc_track_malloc(size_t size, const char *file, int line);
+
+/// @brief calloc that records its call site
+void *alloc_track_calloc(size_t n, size_t size, const char *file, int line);
+
+/// @brief realloc that records its call site
+void *alloc_track_realloc(void *p, size_t size, const char *file, int line);
+
+/// @brief free of memory from the tracking wrappers
+void alloc_track_free(void *p);
+
+#define malloc(size) alloc_track_malloc(size, __FILE__, __LINE__)
+#define calloc(n, size) alloc_track_calloc(n, size, __FILE__, __LINE__)
+#define realloc(p, size) alloc_track_realloc(p, size, __FILE__, __LINE__)
+#define free(p) alloc_track_free(p)
+
+#endif // AOC_ALLOC_TRACK
+
+#endif // AOC_ALLOC_H
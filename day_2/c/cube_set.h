@@ -0,0 +1,40 @@
+#ifndef AOC_CUBE_SET_H
+#define AOC_CUBE_SET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief every cube set of every game, stored as flat arrays
+/// a Game will consist of multiple cube sets, the sets of game i are the draws
+/// offset[i] up to offset[i + 1]. All arrays live in one arena block
+typedef struct GameLog {
+    void *arena;        ///< single allocation backing the arrays below
+    size_t *offset;     ///< first draw of each game, n_games + 1 entries
+    uint32_t *r;        ///< number of red cubes in each draw
+    uint32_t *g;        ///< number of green cubes in each draw
+    uint32_t *b;        ///< number of blue cubes in each draw
+    size_t n_games;     ///< games stored
+    size_t n_draws;     ///< draws stored
+    size_t cap_games;   ///< games the arena has room for
+    size_t cap_draws;   ///< draws the arena has room for
+} GameLog;
+
+/// @brief build the game log with input data, games are appended after any already stored
+/// @param buf games, one per line
+/// @param count number of chars in buf
+/// @param games game log, zero initialized or reused
+void build_cube_set(const char *buf, size_t count, GameLog *games);
+
+/// @brief forget every game but keep the arena for reuse
+void clear_cube_set(GameLog *games);
+
+/// @brief free the game log, the arena goes in one piece
+void free_cube_set(GameLog *games);
+
+/// @brief return sum of all valid games
+uint32_t audit_cube_set(const GameLog *games);
+
+/// @brief find power of cube sets
+uint32_t power_cube_set(const GameLog *games);
+
+#endif // AOC_CUBE_SET_H
@@ -0,0 +1,126 @@
+#include "lines.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+// bytes compared per step of the vector scan
+#define SCAN_WIDTH 32
+
+/// @brief record the start of a line, growing the index as needed
+static void push_line(LineIndex *lines, size_t offset) {
+    if (lines->n_lines == lines->cap) {
+        lines->cap *= 2;
+        lines->start = realloc(lines->start, lines->cap * sizeof(size_t));
+        assert(lines->start);
+    }
+
+    lines->start[lines->n_lines++] = offset;
+}
+
+#ifdef __SSE2__
+/// @brief bitmask of the newlines in an aligned block, bit n is set when byte n is '\n'
+/// @param p SCAN_WIDTH aligned pointer
+static inline uint32_t newline_mask(const char *p) {
+#ifdef __AVX2__
+    __m256i x = _mm256_load_si256((const __m256i *)p);
+
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')));
+#else
+    __m128i lo = _mm_load_si128((const __m128i *)p);
+    __m128i hi = _mm_load_si128((const __m128i *)(p + 16));
+
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, _mm_set1_epi8('\n')))
+        | (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, _mm_set1_epi8('\n'))) << 16;
+#endif
+}
+#endif
+
+size_t line_index_build(const char *buf, size_t count, LineIndex *lines) {
+    memset(lines, 0, sizeof(*lines));
+    lines->buf = buf;
+    lines->count = count;
+
+    // a guess at the number of lines, the index doubles when it is wrong
+    lines->cap = count / 64 + 16;
+    lines->start = malloc(lines->cap * sizeof(size_t));
+    assert(lines->start);
+
+    push_line(lines, 0);
+
+#ifdef __SSE2__
+    // loads are aligned so reading past either end of buf never crosses into another page
+    const char *p = (const char *)((uintptr_t)buf & ~(uintptr_t)(SCAN_WIDTH - 1));
+    const char *end = buf + count;
+    uint32_t nl;
+
+    for (; p < end; p += SCAN_WIDTH) {
+        nl = newline_mask(p);
+        if (p < buf)
+            nl &= ~(uint32_t)0 << (buf - p);
+        if (end - p < SCAN_WIDTH)
+            nl &= ((uint32_t)1 << (end - p)) - 1;
+
+        for (; nl; nl &= nl - 1)
+            push_line(lines, p - buf + __builtin_ctz(nl) + 1);
+    }
+#else
+    const char *p = buf;
+    const char *end = buf + count;
+    const char *nl;
+
+    for (; p < end && (nl = memchr(p, '\n', end - p)) != NULL; p = nl + 1)
+        push_line(lines, nl - buf + 1);
+#endif
+
+    // the end of a final line without a newline
+    if (lines->start[lines->n_lines - 1] != count)
+        push_line(lines, count);
+
+    // the last entry only marks where the last line ends
+    lines->n_lines--;
+
+    return lines->n_lines;
+}
+
+void line_index_free(LineIndex *lines) {
+    free(lines->start);
+    memset(lines, 0, sizeof(*lines));
+}
+
+size_t line_index_shards(const LineIndex *lines, size_t n_shards, size_t min_bytes, size_t *first) {
+    size_t lo, hi, mid, target;
+    size_t i;
+
+    if (min_bytes && n_shards > lines->count / min_bytes + 1)
+        n_shards = lines->count / min_bytes + 1;
+    if (n_shards == 0)
+        n_shards = 1;
+
+    first[0] = 0;
+    first[n_shards] = lines->n_lines;
+
+    // each cut is the first line starting at or after its share of the bytes
+    for (i = 1; i < n_shards; i++) {
+        target = lines->count / n_shards * i;
+        lo = first[i - 1];
+        hi = lines->n_lines;
+        while (lo < hi) {
+            mid = lo + (hi - lo) / 2;
+            if (lines->start[mid] < target)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        first[i] = lo;
+    }
+
+    return n_shards;
+}
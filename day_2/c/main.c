@@ -4,159 +4,291 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "alloc.h"
+#include "cube_set.h"
+#include "import.h"
+#include "lines.h"
+#include "probe.h"
+#include "swar.h"
 
-#define N_GAMES 100
 #define MAX_RED 12
 #define MAX_GREEN 13
 #define MAX_BLUE 14
 
+// games and draws the store has room for before its first grow
+#define GAME_LOG_GAMES 128
+#define GAME_LOG_DRAWS 1024
+
+// most cells the audit index prefix table may use before falling back to a sorted scan
+#define AUDIT_TABLE_MAX (1 << 22)
+
 #define MAX(a, b) (a > b ? a : b)
 
-/// @brief a Game will consist of multiple cube sets
-typedef struct CubeSet {
-    struct CubeSet* next;   ///< next Set of cubes NULL if final set
-    uint32_t r;             ///< number of red cubes in set
-    uint32_t g;             ///< number of green cubes in set
-    uint32_t b;             ///< number of blue cubes in set
-} CubeSet;
-
-/// @brief provide nice struct for tokenizing input
-typedef struct Token {
-    const char *delim;
-    char *tokptr;
-    char *saveptr;
-} Token;
-
-/// @brief import a file to buffer
-/// @param path path of file
-/// @param buf this is the buffer to file. If NULL the function just returns the file length
-/// @return file length
-ssize_t import(const char* path, char* buf) {
-    FILE* fp = NULL;
-    ssize_t fsize = -1;
-
-    fp = fopen(path, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "File import error!\n");
-        goto abort;
-    }
-
-    fseek(fp, 0L, SEEK_END);
-    fsize = ftell(fp);
-    if (fsize < 0) {
-        fprintf(stderr, "File read error!\n");
-        goto abort;
-    }
-
-    if (buf == NULL) {
-        goto abort;
-    }
-
-    rewind(fp);
-
-    if (fread(buf, sizeof(char), fsize, fp) != (size_t)fsize) {
-        fprintf(stderr, "Possible missing data!\n");
-    }
-
-abort:
-    fclose(fp);
-    return fsize;
-}
-
-/// @brief build an array of cube lists with input data
-void build_cube_set(const char *str, CubeSet cube_set[N_GAMES]) {
-    Token sp = { .delim = " " };   // space token
-    Token nl = { .delim = "\n" };  // newline token
-    uint32_t nth_game = 0;
-    uint32_t last_val;
-    char *tokens;
-    CubeSet *curr_set;
-
-    tokens = malloc(strlen(str) + 1);
-    assert(tokens);
-    strcpy(tokens, str);
-    
-    nl.tokptr = strtok_r(tokens, nl.delim, &nl.saveptr);
-    while (nl.tokptr != NULL) {
-        curr_set = &cube_set[nth_game++];
-        memset(curr_set, 0, sizeof(*curr_set));
-
-        sp.tokptr = strtok_r(nl.tokptr, sp.delim, &sp.saveptr);
-
-        // skip game tag and number
-        sp.tokptr = strtok_r(NULL, sp.delim, &sp.saveptr);
-        sp.tokptr = strtok_r(NULL, sp.delim, &sp.saveptr);
-
-        while (sp.tokptr != NULL) {
-            if (strncmp(sp.tokptr, "red", 3) == 0) {
-                curr_set->r = last_val;
-            } else if (strncmp(sp.tokptr, "blue", 4) == 0) {
-                curr_set->b = last_val;
-            } else if (strncmp(sp.tokptr, "green", 5) == 0) {
-                curr_set->g = last_val;
-            } else /* must be digit */ {
-                // save this info for when we get a color tag
-                last_val = strtoul(sp.tokptr, NULL, 10);
-            }
+/// @brief grow the arena so it holds at least n_games games and n_draws draws
+/// everything is moved into one bigger block, capacities at least double so growth is amortized
+/// @param games game log
+/// @param n_games games needed
+/// @param n_draws draws needed
+void reserve_game_log(GameLog *games, size_t n_games, size_t n_draws) {
+    size_t cap_games = games->cap_games ? games->cap_games : GAME_LOG_GAMES;
+    size_t cap_draws = games->cap_draws ? games->cap_draws : GAME_LOG_DRAWS;
+    GameLog grown;
+
+    if (games->arena && n_games <= games->cap_games && n_draws <= games->cap_draws)
+        return;
+
+    while (cap_games < n_games)
+        cap_games *= 2;
+    while (cap_draws < n_draws)
+        cap_draws *= 2;
+    if (games->arena) {
+        cap_games = MAX(cap_games, games->cap_games * 2);
+        cap_draws = MAX(cap_draws, games->cap_draws * 2);
+    }
+
+    grown = *games;
+    grown.arena = malloc((cap_games + 1) * sizeof(size_t) + cap_draws * 3 * sizeof(uint32_t));
+    assert(grown.arena);
+
+    grown.offset = grown.arena;
+    grown.r = (uint32_t *)(grown.offset + cap_games + 1);
+    grown.g = grown.r + cap_draws;
+    grown.b = grown.g + cap_draws;
+    grown.cap_games = cap_games;
+    grown.cap_draws = cap_draws;
+
+    grown.offset[0] = 0;
+    if (games->arena) {
+        memcpy(grown.offset, games->offset, (games->n_games + 1) * sizeof(size_t));
+        memcpy(grown.r, games->r, games->n_draws * sizeof(uint32_t));
+        memcpy(grown.g, games->g, games->n_draws * sizeof(uint32_t));
+        memcpy(grown.b, games->b, games->n_draws * sizeof(uint32_t));
+        free(games->arena);
+    }
+
+    *games = grown;
+}
+
+/// @brief append an empty draw to the last game
+/// @param games game log
+/// @return index of the draw
+static size_t push_draw(GameLog *games) {
+    size_t i = games->n_draws;
+
+    reserve_game_log(games, games->n_games, i + 1);
+    games->r[i] = games->g[i] = games->b[i] = 0;
+    games->n_draws++;
+    games->offset[games->n_games] = games->n_draws;
+
+    return i;
+}
+
+/// @brief append an empty game
+/// @param games game log
+static void push_game(GameLog *games) {
+    reserve_game_log(games, games->n_games + 1, games->n_draws);
+    games->n_games++;
+    games->offset[games->n_games] = games->n_draws;
+}
 
-            sp.tokptr = strtok_r(NULL, sp.delim, &sp.saveptr);
-            // check for semicolon delim at end of last sp.tokptr
-            if (sp.tokptr && *(sp.tokptr - 2) == ';') {
-                // add a link to next child cube set
-                // gets cleaned up in free_cube_set
-                curr_set->next = calloc(1, sizeof(CubeSet));
-                curr_set = curr_set->next;
-                assert(curr_set);
+/// @brief skip the "Game N: " tag of a line
+/// @param p start of the line
+/// @param end end of the input
+/// @return first draw of the game, or the line end if it has none
+static const char *parse_game_tag(const char *p, const char *end) {
+    while (p < end && *p != ':' && *p != '\n')
+        p++;
+
+    return p < end && *p == ':' ? p + 1 : p;
+}
+
+/// @brief parse one draw "k color, k color, k color" of a game without touching the input
+/// numbers are read a word at a time and colors are told apart by their first byte
+/// @param p first byte after the game tag or the previous ';'
+/// @param end end of the input
+/// @param rgb cubes of each color in the draw, colors not drawn are 0
+/// @param more set when another draw of the same game follows
+/// @return first byte after the draw, the next line when it was the last one
+static const char *parse_draw(const char *p, const char *end, uint32_t rgb[3], bool *more) {
+    uint32_t n;
+
+    rgb[0] = rgb[1] = rgb[2] = 0;
+
+    while (p < end) {
+        while (p < end && *p == ' ')
+            p++;
+
+        p += swar_parse_uint(p, end - p, &n);
+
+        while (p < end && *p == ' ')
+            p++;
+
+        if (p < end) {
+            switch (*p) {
+            case 'r': rgb[0] = n; p += 3; break;
+            case 'g': rgb[1] = n; p += 5; break;
+            case 'b': rgb[2] = n; p += 4; break;
             }
         }
 
-        nl.tokptr = strtok_r(NULL, nl.delim, &nl.saveptr);
+        if (p < end && *p == ',') {
+            p++;
+        } else if (p < end && *p == ';') {
+            *more = true;
+            return p + 1;
+        } else {
+            break;
+        }
     }
 
-    free(tokens);
+    // line is done, step over its newline
+    p = p < end ? memchr(p, '\n', end - p) : NULL;
+    *more = false;
+    return p ? p + 1 : end;
 }
 
-/// @brief free cube set child, recursive
-void free_child_cube_set(CubeSet *cube_set) {
-    if (cube_set->next)
-        free_child_cube_set(cube_set->next);
+/// @brief build the game log with input data, games are appended after any already stored
+/// @param buf games, one per line
+/// @param count number of chars in buf
+/// @param games game log, zero initialized or reused
+void build_cube_set(const char *buf, size_t count, GameLog *games) {
+    const char *p = buf;
+    const char *end = buf + count;
+    uint32_t rgb[3];
+    size_t curr_set;
+    bool more;
+
+    reserve_game_log(games, 0, 0);
+
+    while (p < end) {
+        // blank lines aren't games
+        if (*p == '\n') {
+            p++;
+            continue;
+        }
+
+        push_game(games);
+        p = parse_game_tag(p, end);
 
-    free(cube_set);
+        do {
+            p = parse_draw(p, end, rgb, &more);
+            curr_set = push_draw(games);
+            games->r[curr_set] = rgb[0];
+            games->g[curr_set] = rgb[1];
+            games->b[curr_set] = rgb[2];
+        } while (more);
+    }
 }
 
-/// @brief free cube set array
-void free_cube_set(CubeSet cube_set[N_GAMES]) {
-    uint32_t i;
+/// @brief sum of valid games and power of games straight off the input
+/// only the max of each color is kept per game, nothing is stored
+/// @param buf games, one per line
+/// @param count number of chars in buf
+/// @param first_game number of the first game in buf
+/// @param sum adds the number of every valid game
+/// @param power adds the power of every game
+/// @return number of games read
+uint32_t reduce_cube_set(
+    const char *buf,
+    size_t count,
+    uint32_t first_game,
+    uint32_t *sum,
+    uint32_t *power
+) {
+    const char *p = buf;
+    const char *end = buf + count;
+    uint32_t nth_game = first_game;
+    uint32_t rgb[3], max[3];
+    bool more;
+
+    while (p < end) {
+        // blank lines aren't games
+        if (*p == '\n') {
+            p++;
+            continue;
+        }
 
-    for (i = 0; i < N_GAMES; i++) {
-        if (cube_set[i].next)
-            free_child_cube_set(cube_set[i].next);
+        p = parse_game_tag(p, end);
+        max[0] = max[1] = max[2] = 0;
+
+        do {
+            p = parse_draw(p, end, rgb, &more);
+            max[0] = MAX(max[0], rgb[0]);
+            max[1] = MAX(max[1], rgb[1]);
+            max[2] = MAX(max[2], rgb[2]);
+        } while (more);
+
+        if (max[0] <= MAX_RED && max[1] <= MAX_GREEN && max[2] <= MAX_BLUE)
+            *sum += nth_game;
+        *power += max[0] * max[1] * max[2];
+        nth_game++;
+    }
+
+    return nth_game - first_game;
+}
+
+/// @brief sum of valid games and power of games of an indexed log
+/// every line is parsed on its own so no draw ever looks past its newline
+/// @param lines index of the games, one per line
+/// @param sum adds the number of every valid game
+/// @param power adds the power of every game
+/// @return number of games read
+uint32_t reduce_game_lines(const LineIndex *lines, uint32_t *sum, uint32_t *power) {
+    uint32_t nth_game = 1;
+
+    for (size_t i = 0; i < lines->n_lines; i++)
+        nth_game += reduce_cube_set(line_at(lines, i), line_length(lines, i), nth_game, sum, power);
+
+    return nth_game - 1;
+}
+
+/// @brief forget every game but keep the arena for reuse
+void clear_cube_set(GameLog *games) {
+    games->n_games = games->n_draws = 0;
+    if (games->arena)
+        games->offset[0] = 0;
+}
+
+/// @brief free the game log, the arena goes in one piece
+void free_cube_set(GameLog *games) {
+    free(games->arena);
+    memset(games, 0, sizeof(*games));
+}
+
+/// @brief returns validity of a game, every set must be within the limits
+bool audit_game(const GameLog *games, size_t game) {
+    bool valid = true;
+
+    for (size_t i = games->offset[game]; i < games->offset[game + 1]; i++) {
+        valid &= games->r[i] <= MAX_RED &&
+                 games->g[i] <= MAX_GREEN &&
+                 games->b[i] <= MAX_BLUE;
     }
+
+    return valid;
 }
 
-/// @brief returns validity of child game, recursive
-bool audit_cube_set_child(CubeSet *cube_set) {
-    if (cube_set->r > MAX_RED ||
-        cube_set->g > MAX_GREEN ||
-        cube_set->b > MAX_BLUE
-    ) return false;
+/// @brief find power of a game, the product of the max of each color
+uint32_t power_game(const GameLog *games, size_t game) {
+    uint32_t r_max = 0;
+    uint32_t g_max = 0;
+    uint32_t b_max = 0;
 
-    return cube_set->next
-        ? audit_cube_set_child(cube_set->next)
-        : true;
+    for (size_t i = games->offset[game]; i < games->offset[game + 1]; i++) {
+        r_max = MAX(r_max, games->r[i]);
+        g_max = MAX(g_max, games->g[i]);
+        b_max = MAX(b_max, games->b[i]);
+    }
+
+    return r_max * g_max * b_max;
 }
 
 /// @brief return sum of all valid games
-uint32_t audit_cube_set(CubeSet cube_set[N_GAMES]) {
+uint32_t audit_cube_set(const GameLog *games) {
     uint32_t sum = 0;
 
-    for (uint32_t i = 0; i < N_GAMES; i++) {
-        if (cube_set[i].r > MAX_RED ||
-            cube_set[i].g > MAX_GREEN ||
-            cube_set[i].b > MAX_BLUE
-        ) continue;
-
-        if (cube_set[i].next && audit_cube_set_child(cube_set[i].next)) {
+    for (size_t i = 0; i < games->n_games; i++) {
+        if (audit_game(games, i)) {
             sum += i + 1; // adjust for zero index
         }
     }
@@ -165,52 +297,267 @@ uint32_t audit_cube_set(CubeSet cube_set[N_GAMES]) {
 }
 
 /// @brief find power of cube sets
-uint32_t power_cube_set(CubeSet cube_set[N_GAMES]) {
+uint32_t power_cube_set(const GameLog *games) {
     uint32_t power = 0;
-    uint32_t r_max = 0;
-    uint32_t g_max = 0;
-    uint32_t b_max = 0;
-    CubeSet *curr_set;
-    
-    for (uint32_t i = 0; i < N_GAMES; i++) {
-        curr_set = &cube_set[i];
-        while (curr_set != NULL) {
-            r_max = MAX(r_max, curr_set->r);
-            g_max = MAX(g_max, curr_set->g);
-            b_max = MAX(b_max, curr_set->b);
-            curr_set = curr_set->next;
-        }
 
-        power += r_max * g_max * b_max;
-        r_max = g_max = b_max = 0;
+    for (size_t i = 0; i < games->n_games; i++) {
+        power += power_game(games, i);
     }
 
     return power;
 }
 
-int main(void) {
-    char *buf = NULL;
+/// @brief answers "sum of games valid under limits r, g, b" for many limits at once
+/// each game is reduced to its max of each color, the distinct maxima of each color form the
+/// axes of a 3D prefix table so a query is three binary searches and one lookup. When the
+/// axes are too big for the table the games are kept sorted by red instead
+typedef struct AuditIndex {
+    uint32_t *axis[3];  ///< sorted distinct max per color
+    size_t dim[3];      ///< entries in each axis
+    uint64_t *table;    ///< sum of game numbers with every max <= the axis values, or NULL
+    uint32_t *games;    ///< fallback, r g b and game number of each game sorted by r
+    size_t n_games;     ///< games indexed
+} AuditIndex;
+
+/// @brief qsort order for uint32_t
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/// @brief qsort order for the fallback games, by red
+static int cmp_game_red(const void *a, const void *b) {
+    return cmp_u32(a, b);
+}
+
+/// @brief number of axis values <= limit
+static size_t axis_rank(const uint32_t *axis, size_t dim, uint32_t limit) {
+    size_t lo = 0, hi = dim, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (axis[mid] <= limit)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/// @brief precompute each game's max once and index them for limit queries
+/// @param games game log
+/// @param index filled in, free with free_audit_index
+void build_audit_index(const GameLog *games, AuditIndex *index) {
+    uint32_t *max;
+    size_t n = games->n_games;
+    size_t i, j, k, c, d, cells;
+    size_t at[3];
+
+    memset(index, 0, sizeof(*index));
+    index->n_games = n;
+
+    // r g b and game number of each game
+    max = calloc(n * 4 + 1, sizeof(uint32_t));
+    assert(max);
+    for (i = 0; i < n; i++) {
+        for (j = games->offset[i]; j < games->offset[i + 1]; j++) {
+            max[i * 4 + 0] = MAX(max[i * 4 + 0], games->r[j]);
+            max[i * 4 + 1] = MAX(max[i * 4 + 1], games->g[j]);
+            max[i * 4 + 2] = MAX(max[i * 4 + 2], games->b[j]);
+        }
+        max[i * 4 + 3] = i + 1; // adjust for zero index
+    }
+
+    // distinct values of each color
+    cells = 1;
+    for (c = 0; c < 3; c++) {
+        index->axis[c] = calloc(n + 1, sizeof(uint32_t));
+        assert(index->axis[c]);
+
+        for (i = 0; i < n; i++)
+            index->axis[c][i] = max[i * 4 + c];
+        qsort(index->axis[c], n, sizeof(uint32_t), cmp_u32);
+
+        for (i = d = 0; i < n; i++) {
+            if (d == 0 || index->axis[c][d - 1] != index->axis[c][i])
+                index->axis[c][d++] = index->axis[c][i];
+        }
+        index->dim[c] = d;
+
+        cells = d && cells > AUDIT_TABLE_MAX / d ? AUDIT_TABLE_MAX + 1 : cells * d;
+    }
+
+    if (cells > AUDIT_TABLE_MAX) {
+        qsort(max, n, sizeof(uint32_t) * 4, cmp_game_red);
+        index->games = max;
+        return;
+    }
+
+    index->table = calloc(cells + 1, sizeof(uint64_t));
+    assert(index->table);
+
+    #define CELL(i, j, k) index->table[((i) * index->dim[1] + (j)) * index->dim[2] + (k)]
+
+    for (i = 0; i < n; i++) {
+        for (c = 0; c < 3; c++)
+            at[c] = axis_rank(index->axis[c], index->dim[c], max[i * 4 + c]) - 1;
+        CELL(at[0], at[1], at[2]) += max[i * 4 + 3];
+    }
+
+    // a running sum along each axis in turn makes every cell the sum of the box below it
+    for (c = 0; c < 3; c++) {
+        for (i = 0; i < index->dim[0]; i++) {
+            for (j = 0; j < index->dim[1]; j++) {
+                for (k = 0; k < index->dim[2]; k++) {
+                    if (c == 0 && i) CELL(i, j, k) += CELL(i - 1, j, k);
+                    if (c == 1 && j) CELL(i, j, k) += CELL(i, j - 1, k);
+                    if (c == 2 && k) CELL(i, j, k) += CELL(i, j, k - 1);
+                }
+            }
+        }
+    }
+
+    #undef CELL
+
+    free(max);
+}
+
+/// @brief sum of the numbers of every game valid under the limits
+/// @param index built index
+/// @param r most red cubes allowed
+/// @param g most green cubes allowed
+/// @param b most blue cubes allowed
+/// @return sum of valid games
+uint64_t query_audit_index(const AuditIndex *index, uint32_t r, uint32_t g, uint32_t b) {
+    size_t i, j, k;
+    uint64_t sum = 0;
+
+    if (index->table == NULL) {
+        // only games up to the red limit can be valid
+        for (i = 0; i < index->n_games && index->games[i * 4] <= r; i++) {
+            if (index->games[i * 4 + 1] <= g && index->games[i * 4 + 2] <= b)
+                sum += index->games[i * 4 + 3];
+        }
+        return sum;
+    }
+
+    i = axis_rank(index->axis[0], index->dim[0], r);
+    j = axis_rank(index->axis[1], index->dim[1], g);
+    k = axis_rank(index->axis[2], index->dim[2], b);
+    if (i == 0 || j == 0 || k == 0)
+        return 0;
+
+    return index->table[((i - 1) * index->dim[1] + (j - 1)) * index->dim[2] + (k - 1)];
+}
+
+/// @brief free an index made by build_audit_index
+void free_audit_index(AuditIndex *index) {
+    for (size_t c = 0; c < 3; c++)
+        free(index->axis[c]);
+    free(index->table);
+    free(index->games);
+    memset(index, 0, sizeof(*index));
+}
+
+/// @brief audit and power games one line at a time so any number of games runs in fixed memory
+/// @param stream open stream
+/// @param sum sum of valid games
+/// @param power power of games
+/// @return 0 on success or -1 on read error
+int stream_cube_set(ImportStream *stream, uint32_t *sum, uint32_t *power) {
+    const char *line;
     ssize_t len;
-    CubeSet games[N_GAMES];
-    uint32_t sum, power;
+    uint32_t nth_game = 1;
+
+    *sum = *power = 0;
 
-    len = import("input.txt", NULL);
-    assert(len > 0);
-    buf = calloc(len + 1, sizeof(char));
-    assert(buf);
+    while ((len = import_stream_line(stream, &line)) > 0) {
+        nth_game += reduce_cube_set(line, len, nth_game, sum, power);
+    }
 
-    import("input.txt", buf);
-    build_cube_set(buf, games);
+    return len < 0 ? -1 : 0;
+}
 
-    sum = audit_cube_set(games);
-    printf("sum of valid games: %u\n", sum);
+/// @brief answer "r,g,b" limit queries against one game log
+/// @param buf games, one per line
+/// @param count number of chars in buf
+/// @param queries limits as "r,g,b" strings
+/// @param n_queries number of queries
+void audit_queries(const char *buf, size_t count, char **queries, size_t n_queries) {
+    GameLog games = { 0 };
+    AuditIndex index;
+    uint32_t r, g, b;
+    size_t i;
+
+    build_cube_set(buf, count, &games);
+    build_audit_index(&games, &index);
+
+    for (i = 0; i < n_queries; i++) {
+        if (sscanf(queries[i], "%u,%u,%u", &r, &g, &b) != 3) {
+            fprintf(stderr, "Bad limits %s, expected r,g,b\n", queries[i]);
+            continue;
+        }
+        printf("sum of valid games for %u,%u,%u: %lu\n",
+               r, g, b, (unsigned long)query_audit_index(&index, r, g, b));
+    }
 
-    power = power_cube_set(games);
-    printf("power of games: %u\n", power);
+    free_audit_index(&index);
+    free_cube_set(&games);
+}
 
-    free_cube_set(games);
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "input.txt";
+    ImportView view;
+    ImportStream stream;
+    LineIndex lines;
+    ssize_t len;
+    uint32_t sum = 0, power = 0;
+    int err;
+
+    if (import_is_file(path)) {
+        PROBE_BEGIN("import");
+        len = import_map(path, &view, IMPORT_HUGE_PAGES);
+        PROBE_END("import");
+        assert(len > 0);
+
+        PROBE_BEGIN("index");
+        line_index_build(view.buf, len, &lines);
+        PROBE_END("index");
+
+        PROBE_BEGIN("solve");
+        reduce_game_lines(&lines, &sum, &power);
+        PROBE_END("solve");
+        line_index_free(&lines);
+
+        // any further arguments are extra limits to audit against
+        if (argc > 2) {
+            PROBE_BEGIN("audit");
+            audit_queries(view.buf, len, argv + 2, argc - 2);
+            PROBE_END("audit");
+        }
+
+        import_unmap(&view);
+    } else {
+        // pipes and stdin can't be mapped so read them a line at a time
+        PROBE_BEGIN("import");
+        err = import_stream_open(path, &stream, 0);
+        PROBE_END("import");
+        assert(err == 0);
+
+        PROBE_BEGIN("stream");
+        err = stream_cube_set(&stream, &sum, &power);
+        PROBE_END("stream");
+
+        import_stream_close(&stream);
+        if (err)
+            return 1;
+    }
 
-    free(buf);
+    printf("sum of valid games: %u\n", sum);
+    printf("power of games: %u\n", power);
 
     return 0;
 }
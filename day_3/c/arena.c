@@ -0,0 +1,85 @@
+#include "arena.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+
+// alignment of everything handed out, enough for any type the solvers use
+#define ARENA_ALIGN 16
+
+/// @brief header of a request the block had no room for, the memory follows it
+typedef struct ArenaSpill {
+    struct ArenaSpill *next;    ///< spill before this one
+} ArenaSpill;
+
+void arena_init(Arena *arena, size_t cap) {
+    memset(arena, 0, sizeof(*arena));
+
+    if (cap) {
+        cap = (cap + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+        arena->base = malloc(cap);
+        assert(arena->base);
+        arena->cap = cap;
+    }
+}
+
+void *arena_calloc(Arena *arena, size_t n, size_t size) {
+    size_t bytes;
+    ArenaSpill *spill;
+    void *p;
+
+    assert(size == 0 || n <= (SIZE_MAX - ARENA_ALIGN * 2) / size);
+    bytes = (n * size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    if (bytes <= arena->cap - arena->used) {
+        p = arena->base + arena->used;
+        arena->used += bytes;
+        memset(p, 0, n * size);
+        return p;
+    }
+
+    // no room, the heap serves it this round and the block grows at the next reset
+    spill = calloc(1, ARENA_ALIGN + bytes);
+    assert(spill);
+    spill->next = arena->spills;
+    arena->spills = spill;
+    arena->spilled += bytes;
+
+    return (char *)spill + ARENA_ALIGN;
+}
+
+/// @brief free the heap blocks of requests the block had no room for
+static void free_spills(Arena *arena) {
+    ArenaSpill *spill;
+
+    while ((spill = arena->spills) != NULL) {
+        arena->spills = spill->next;
+        free(spill);
+    }
+}
+
+void arena_reset(Arena *arena) {
+    size_t need = arena->used + arena->spilled;
+
+    free_spills(arena);
+
+    // grow to what the round needed, at least doubling so growth is amortized
+    if (arena->spilled) {
+        free(arena->base);
+        arena->cap = need > arena->cap * 2 ? need : arena->cap * 2;
+        arena->base = malloc(arena->cap);
+        assert(arena->base);
+    }
+
+    arena->used = 0;
+    arena->spilled = 0;
+}
+
+void arena_free(Arena *arena) {
+    free_spills(arena);
+    free(arena->base);
+    memset(arena, 0, sizeof(*arena));
+}
@@ -0,0 +1,38 @@
+#ifndef AOC_ARENA_H
+#define AOC_ARENA_H
+
+#include <stddef.h>
+
+/// @brief scratch memory handed out by bumping a pointer and given back all at once
+/// a request that doesn't fit is served by the heap until the next arena_reset, which then
+/// grows the block to everything the round asked for. A solver that asks for the same amount
+/// every round, like once per row, stops touching the heap after its first round
+typedef struct Arena {
+    char *base;             ///< block memory is handed out from
+    size_t cap;             ///< bytes in the block
+    size_t used;            ///< bytes handed out from the block
+    size_t spilled;         ///< bytes served by the heap since the last reset
+    struct ArenaSpill *spills; ///< heap blocks to free at the next reset
+} Arena;
+
+/// @brief make an arena
+/// @param arena arena to fill in, free with arena_free
+/// @param cap bytes to start with, 0 allocates nothing until first use
+void arena_init(Arena *arena, size_t cap);
+
+/// @brief get zeroed memory that lives until the next arena_reset
+/// @param arena arena to take from
+/// @param n number of elements
+/// @param size bytes per element
+/// @return memory aligned for any type
+void *arena_calloc(Arena *arena, size_t n, size_t size);
+
+/// @brief give back everything handed out since the last reset
+/// @param arena arena to reset
+void arena_reset(Arena *arena);
+
+/// @brief free an arena made by arena_init
+/// @param arena arena to free, zeroed afterwards
+void arena_free(Arena *arena);
+
+#endif // AOC_ARENA_H
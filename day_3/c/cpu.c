@@ -0,0 +1,59 @@
+#include "cpu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// @brief AOC_CPU names, index is the tier
+static const char *tier_names[CPU_TIERS] = {
+    "scalar",
+    "sse4.2",
+    "avx2",
+    "avx512",
+};
+
+/// @brief best tier the cpu and the OS both support
+static CpuTier detect_tier(void) {
+#ifdef CPU_DISPATCH
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return CPU_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2"))
+        return CPU_AVX2;
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+        return CPU_SSE42;
+#endif
+
+    return CPU_SCALAR;
+}
+
+CpuTier cpu_tier(void) {
+    static int tier = -1;
+    const char *env;
+    int i;
+
+    if (tier >= 0)
+        return tier;
+
+    tier = detect_tier();
+
+    env = getenv("AOC_CPU");
+    if (env == NULL)
+        return tier;
+
+    for (i = 0; i < CPU_TIERS && strcmp(env, tier_names[i]) != 0; i++);
+
+    if (i == CPU_TIERS)
+        fprintf(stderr, "Unknown AOC_CPU tier %s, using %s!\n", env, tier_names[tier]);
+    else if (i > tier)
+        fprintf(stderr, "AOC_CPU tier %s isn't supported here, using %s!\n", env, tier_names[tier]);
+    else
+        tier = i;
+
+    return tier;
+}
+
+const char *cpu_tier_name(CpuTier tier) {
+    return tier < CPU_TIERS ? tier_names[tier] : "unknown";
+}
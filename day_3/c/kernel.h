@@ -0,0 +1,116 @@
+// vector kernels of day 3, main.c includes this once per cpu tier
+// each copy is built under that tier's #pragma GCC target and named through KERNEL(name), the
+// ISA macros the pragma turns on pick the instructions of the copy
+
+#if defined(__AVX512BW__)
+#define KERNEL_WIDTH 64
+#define KERNEL_MASK (~(uint64_t)0)
+#elif defined(__AVX2__)
+#define KERNEL_WIDTH 32
+#define KERNEL_MASK (((uint64_t)1 << 32) - 1)
+#else
+#define KERNEL_WIDTH 16
+#define KERNEL_MASK (((uint64_t)1 << 16) - 1)
+#endif
+
+/// @brief bitmasks of KERNEL_WIDTH cells, bit n is set when cell n matches
+/// @param p first cell
+/// @param digit set for '0' - '9'
+/// @param dot set for '.'
+static inline void KERNEL(classify_cells)(const char *p, uint64_t *digit, uint64_t *dot) {
+#if defined(__AVX512BW__)
+    __m512i x = _mm512_loadu_si512((const void *)p);
+
+    // c - '0' <= 9 unsigned is a digit
+    *digit = _mm512_cmple_epu8_mask(_mm512_sub_epi8(x, _mm512_set1_epi8('0')), _mm512_set1_epi8(9));
+    *dot = _mm512_cmpeq_epi8_mask(x, _mm512_set1_epi8('.'));
+#elif defined(__AVX2__)
+    __m256i x = _mm256_loadu_si256((const __m256i *)p);
+    __m256i t = _mm256_sub_epi8(x, _mm256_set1_epi8('0'));
+
+    // c - '0' <= 9 unsigned is a digit
+    *digit = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(9)), t));
+    *dot = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('.')));
+#else
+    __m128i x = _mm_loadu_si128((const __m128i *)p);
+    __m128i t = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+
+    // c - '0' <= 9 unsigned is a digit
+    *digit = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(9)), t));
+    *dot = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('.')));
+#endif
+}
+
+/// @brief set the bit of every symbol cell of a row
+/// @param row first cell of the row
+/// @param cols cells in the row, not counting the newline
+/// @param bits zeroed bitmap with room for cols bits
+void KERNEL(symbol_row)(const char *row, size_t cols, uint64_t *bits) {
+    uint64_t digit, dot;
+    size_t c = 0;
+
+    // a symbol is anything that isn't a '.' or a digit
+    for (; c + KERNEL_WIDTH <= cols; c += KERNEL_WIDTH) {
+        KERNEL(classify_cells)(row + c, &digit, &dot);
+        bits[c / ROW_BITS] |= (~(digit | dot) & KERNEL_MASK) << (c % ROW_BITS);
+    }
+
+    symbol_cells(row, c, cols, bits);
+}
+
+/// @brief OR three rows together, the vertical half of the dilation
+/// @param a row above
+/// @param b row
+/// @param c row below
+/// @param out a | b | c
+/// @param words words in a row
+void KERNEL(or_rows)(const uint64_t *a, const uint64_t *b, const uint64_t *c, uint64_t *out, size_t words) {
+    size_t w = 0;
+
+#if defined(__AVX512BW__)
+    for (; w + 8 <= words; w += 8) {
+        __m512i x = _mm512_or_si512(_mm512_loadu_si512((const void *)(a + w)),
+                                    _mm512_loadu_si512((const void *)(b + w)));
+        _mm512_storeu_si512((void *)(out + w), _mm512_or_si512(x, _mm512_loadu_si512((const void *)(c + w))));
+    }
+#elif defined(__AVX2__)
+    for (; w + 4 <= words; w += 4) {
+        __m256i x = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(a + w)),
+                                    _mm256_loadu_si256((const __m256i *)(b + w)));
+        x = _mm256_or_si256(x, _mm256_loadu_si256((const __m256i *)(c + w)));
+        _mm256_storeu_si256((__m256i *)(out + w), x);
+    }
+#else
+    for (; w + 2 <= words; w += 2) {
+        __m128i x = _mm_or_si128(_mm_loadu_si128((const __m128i *)(a + w)),
+                                 _mm_loadu_si128((const __m128i *)(b + w)));
+        x = _mm_or_si128(x, _mm_loadu_si128((const __m128i *)(c + w)));
+        _mm_storeu_si128((__m128i *)(out + w), x);
+    }
+#endif
+
+    for (; w < words; w++)
+        out[w] = a[w] | b[w] | c[w];
+}
+
+/// @brief find the first digit at or after cell i, KERNEL_WIDTH cells at a time
+/// @param buf graph
+/// @param i cell to start at
+/// @param count number of cells in buf
+/// @return index of the digit, or count if there is none
+size_t KERNEL(next_digit)(const char *buf, size_t i, size_t count) {
+    uint64_t digit, dot;
+
+    for (; i + KERNEL_WIDTH <= count; i += KERNEL_WIDTH) {
+        KERNEL(classify_cells)(buf + i, &digit, &dot);
+        if (digit)
+            return i + __builtin_ctzll(digit);
+    }
+
+    for (; i < count && !isdigit(buf[i]); i++);
+
+    return i;
+}
+
+#undef KERNEL_WIDTH
+#undef KERNEL_MASK
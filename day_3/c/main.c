@@ -1,11 +1,29 @@
 #include <ctype.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <unistd.h>
+#include "./alloc.h"
+#include "./arena.h"
+#include "./cpu.h"
 #include "./import.h"
+#include "./lines.h"
+#include "./probe.h"
+#include "./schematic.h"
+
+#ifdef CPU_DISPATCH
+#include <immintrin.h>
+#endif
+
+// cells per word of a row bitmap
+#define ROW_BITS 64
+
+// fewest rows worth handing to their own thread
+#define BAND_MIN 256
 
 /// @brief query width of a char buf
 /// @param buf NULL terminated buffer
@@ -28,265 +46,744 @@ bool is_symbol(char c) {
     return c != '.' && !isdigit(c);
 }
 
-/// @brief sum the graph
+/// @brief set the bit of every symbol cell of a row from cell c on, one cell at a time
+/// @param row first cell of the row
+/// @param c first cell to look at
+/// @param cols cells in the row, not counting the newline
+/// @param bits zeroed bitmap with room for cols bits
+static inline void symbol_cells(const char *row, size_t c, size_t cols, uint64_t *bits) {
+    for (; c < cols; c++) {
+        if (is_symbol(row[c]))
+            bits[c / ROW_BITS] |= (uint64_t)1 << (c % ROW_BITS);
+    }
+}
+
+/// @brief set the bit of every symbol cell of a row
+/// @param row first cell of the row
+/// @param cols cells in the row, not counting the newline
+/// @param bits zeroed bitmap with room for cols bits
+void symbol_row_scalar(const char *row, size_t cols, uint64_t *bits) {
+    symbol_cells(row, 0, cols, bits);
+}
+
+/// @brief spread every set bit of a row to its left and right neighbour
+/// @param bits row bitmap
+/// @param out dilated row
+/// @param words words in a row
+static void dilate_row(const uint64_t *bits, uint64_t *out, size_t words) {
+    size_t w;
+
+    for (w = 0; w < words; w++) {
+        out[w] = bits[w] | bits[w] << 1 | bits[w] >> 1;
+        if (w > 0)
+            out[w] |= bits[w - 1] >> (ROW_BITS - 1);
+        if (w + 1 < words)
+            out[w] |= bits[w + 1] << (ROW_BITS - 1);
+    }
+}
+
+/// @brief OR three rows together, the vertical half of the dilation
+/// @param a row above
+/// @param b row
+/// @param c row below
+/// @param out a | b | c
+/// @param words words in a row
+void or_rows_scalar(const uint64_t *a, const uint64_t *b, const uint64_t *c, uint64_t *out, size_t words) {
+    for (size_t w = 0; w < words; w++)
+        out[w] = a[w] | b[w] | c[w];
+}
+
+/// @brief find the first digit at or after cell i
+/// @param buf graph
+/// @param i cell to start at
+/// @param count number of cells in buf
+/// @return index of the digit, or count if there is none
+size_t next_digit_scalar(const char *buf, size_t i, size_t count) {
+    for (; i < count && !isdigit(buf[i]); i++);
+
+    return i;
+}
+
+#ifdef CPU_DISPATCH
+#pragma GCC push_options
+#pragma GCC target("sse4.2,popcnt")
+#define KERNEL(name) name##_sse42
+#include "./kernel.h"
+#undef KERNEL
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2,bmi,bmi2,popcnt")
+#define KERNEL(name) name##_avx2
+#include "./kernel.h"
+#undef KERNEL
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx2,bmi,bmi2,popcnt")
+#define KERNEL(name) name##_avx512
+#include "./kernel.h"
+#undef KERNEL
+#pragma GCC pop_options
+#endif
+
+// kernels of the running cpu's tier, picked before main runs
+static void (*symbol_row)(const char *, size_t, uint64_t *) = symbol_row_scalar;
+static void (*or_rows)(const uint64_t *, const uint64_t *, const uint64_t *, uint64_t *, size_t) = or_rows_scalar;
+static size_t (*next_digit)(const char *, size_t, size_t) = next_digit_scalar;
+
+/// @brief point the kernels at the best tier the cpu has, AOC_CPU can force a lower one
+__attribute__((constructor))
+static void select_kernels(void) {
+#ifdef CPU_DISPATCH
+    switch (cpu_tier()) {
+    case CPU_AVX512:
+        symbol_row = symbol_row_avx512;
+        or_rows = or_rows_avx512;
+        next_digit = next_digit_avx512;
+        break;
+    case CPU_AVX2:
+        symbol_row = symbol_row_avx2;
+        or_rows = or_rows_avx2;
+        next_digit = next_digit_avx2;
+        break;
+    case CPU_SSE42:
+        symbol_row = symbol_row_sse42;
+        or_rows = or_rows_sse42;
+        next_digit = next_digit_sse42;
+        break;
+    default:
+        break;
+    }
+#endif
+}
+
+/// @brief query if any bit from first to last is set
+static bool any_bit(const uint64_t *bits, size_t first, size_t last) {
+    size_t w = first / ROW_BITS;
+    uint64_t mask = ~(uint64_t)0 << (first % ROW_BITS);
+
+    for (; w < last / ROW_BITS; w++, mask = ~(uint64_t)0) {
+        if (bits[w] & mask)
+            return true;
+    }
+
+    mask &= ~(uint64_t)0 >> (ROW_BITS - 1 - last % ROW_BITS);
+    return (bits[w] & mask) != 0;
+}
+
+/// @brief number of rows in a graph, the last one may be missing its newline
+size_t graph_rows(size_t count, size_t width) {
+    return (count + 1) / width;
+}
+
+/// @brief sum the part numbers in rows first up to last of the graph
+/// the symbols of each row are packed into a bitmap and dilated sideways and up and down into
+/// a map of every cell next to a symbol, a number is a part number if any bit under it is set.
+/// The rows just outside the band are read as a halo but none of their numbers are counted
 /// @param char buf
 /// @param how many elems
 /// @param width of graph
+/// @param first first row of the band
+/// @param last row after the band
+/// @param scratch arena the bitmaps are taken from, the caller resets it
 /// @return sum
-uint32_t sum(const char *buf, size_t count, size_t width) {
+uint32_t sum_band(const char *buf, size_t count, size_t width, size_t first, size_t last, Arena *scratch) {
+    size_t cols = width - 1;
+    size_t lo = first ? first - 1 : 0;
+    size_t hi = last < graph_rows(count, width) ? last + 1 : graph_rows(count, width);
+    size_t words = cols / ROW_BITS + 1;
+    uint64_t *sym, *spread, *near;
     uint32_t sum = 0;
-    uint32_t curr = 0;
-    bool valid = false;
-    size_t i = 0;
-    char c;
-
-    // if bound is true then that attrib is ignored
-    // for example bound.above == true we don't check above the node
-    struct Bound {
-        bool above;
-        bool below;
-        bool left;
-        bool right;
-    } bound;
-
-    for (i = 0; i < count; i++) {
-        c = buf[i];
-
-        // if not digit reset
-        if (!isdigit(c)) {
-            if (valid) {
-                sum += curr;
-            }
-            curr = valid = 0;
-            continue;
-        }
+    uint32_t curr;
+    size_t r, c, start;
+    const char *row;
+
+    // one blank row of padding above and below the band and its halo
+    sym = arena_calloc(scratch, (hi - lo + 2) * words, sizeof(uint64_t));
+    spread = arena_calloc(scratch, (hi - lo + 2) * words, sizeof(uint64_t));
+    near = arena_calloc(scratch, words, sizeof(uint64_t));
+
+    for (r = lo; r < hi; r++) {
+        symbol_row(buf + r * width, cols, sym + (r - lo + 1) * words);
+        dilate_row(sym + (r - lo + 1) * words, spread + (r - lo + 1) * words, words);
+    }
 
-        curr = curr * 10 + (c - '0');
+    for (r = first; r < last; r++) {
+        or_rows(spread + (r - lo) * words,
+                spread + (r - lo + 1) * words,
+                spread + (r - lo + 2) * words,
+                near, words);
+        row = buf + r * width;
 
-        // don't search if already valid
-        if (valid)
-            continue;
+        for (c = 0; c < cols; c++) {
+            if (!isdigit(row[c]))
+                continue;
 
-        bound = (struct Bound){
-            .above = i < width,
-            .below = i > count - width - 1,
-            .left = (i % width) == 0,
-            .right = (i % width) == width - 2, // account for nl
-        };
+            for (start = c, curr = 0; c < cols && isdigit(row[c]); c++)
+                curr = curr * 10 + (row[c] - '0');
 
-        // query validity, this is branchless for readability
-
-        // @ . .
-        // . . .
-        // . . .
-        valid = valid || (!bound.above && !bound.left && is_symbol(buf[i - width - 1]));
-        // . @ .
-        // . . .
-        // . . .
-        valid = valid || (!bound.above && is_symbol(buf[i - width]));
-        // . . @
-        // . . .
-        // . . .
-        valid = valid || (!bound.above && !bound.right && is_symbol(buf[i - width + 1]));
-        // . . .
-        // @ . .
-        // . . .
-        valid = valid || (!bound.left && is_symbol(buf[i - 1]));
-        // . . .
-        // . . @
-        // . . .
-        valid = valid || (!bound.right && is_symbol(buf[i + 1]));
-        // . . .
-        // . . .
-        // @ . .
-        valid = valid || (!bound.below && !bound.left && is_symbol(buf[i + width - 1]));
-        // . . .
-        // . . .
-        // . @ .
-        valid = valid || (!bound.below && is_symbol(buf[i + width]));
-        // . . .
-        // . . .
-        // . . @
-        valid = valid || (!bound.below && !bound.right && is_symbol(buf[i + width + 1]));
+            if (any_bit(near, start, c - 1))
+                sum += curr;
+        }
     }
 
     return sum;
 }
 
-/// @brief give it a buffer and index at a gear. The offset is wear a part of a digit is
-/// @param buf buffer of atleast size index
-/// @param width maximum number of elements that compose number
-/// @param index the current index of the gear
-/// @param offset the offset of the digit to query
-uint32_t buf_to_uint(const char *buf, size_t width, size_t index, size_t offset) {
-    char *num_buf, *start;
-    int32_t i;
-    int32_t buf_offset = index + offset;
-    int32_t num_buf_offset = buf_offset % width;
-
-    assert(isdigit(buf[buf_offset]));
-
-    // this is a slice of the row we are trying to determine the digit of like:
-    // \0 \0 \0 '3' '2' '1' \0 \0 \0 ...
-    num_buf = calloc(width + 1, sizeof(char));
-    assert(num_buf);
-
-    // slide right until hit non-digit
-    for (i = 0; (num_buf_offset + i) < (int64_t)width && isdigit(buf[buf_offset + i]); i++) {
-        num_buf[num_buf_offset + i] = buf[buf_offset + i];
-    }
+/// @brief sum the graph
+/// @param char buf
+/// @param how many elems
+/// @param width of graph
+/// @return sum
+uint32_t sum(const char *buf, size_t count, size_t width) {
+    Arena scratch;
+    uint32_t ret;
+
+    arena_init(&scratch, 0);
+    ret = sum_band(buf, count, width, 0, graph_rows(count, width), &scratch);
+    arena_free(&scratch);
 
-    // slide left until hit non-digit
-    for (i = -1; (num_buf_offset + i) >= 0 && isdigit(buf[buf_offset + i]); i--) {
-        num_buf[num_buf_offset + i] = buf[buf_offset + i];
+    return ret;
+}
+
+/// @brief every number of the graph, labelled cell by cell
+typedef struct NumberLabels {
+    uint32_t *base;     ///< allocation of label, with a padding row before and after
+    uint32_t *label;    ///< label of each cell, 0 for none else index + 1 into value
+    uint32_t *value;    ///< parsed value of each number
+    size_t n_numbers;   ///< numbers found
+} NumberLabels;
+
+/// @brief give every number an id and parse it once
+/// the label map is padded by a row of zeros on both ends and the newline column of each row
+/// is zero too, so all eight neighbours of any cell can be read without bounds checks
+/// @param char buf
+/// @param how many elems
+/// @param width of graph
+/// @param labels filled in, lives until scratch is reset
+/// @param scratch arena the labels are taken from
+void label_numbers(const char *buf, size_t count, size_t width, NumberLabels *labels, Arena *scratch) {
+    size_t i;
+    uint32_t curr;
+
+    labels->base = arena_calloc(scratch, count + 2 * (width + 1), sizeof(uint32_t));
+    labels->value = arena_calloc(scratch, count / 2 + 1, sizeof(uint32_t));
+    labels->label = labels->base + width + 1;
+    labels->n_numbers = 0;
+
+    for (i = next_digit(buf, 0, count); i < count; i = next_digit(buf, i, count)) {
+        for (curr = 0; i < count && isdigit(buf[i]); i++) {
+            curr = curr * 10 + (buf[i] - '0');
+            labels->label[i] = labels->n_numbers + 1;
+        }
+        labels->value[labels->n_numbers++] = curr;
     }
+}
+
+/// @brief find gear ratio of the gears in rows first up to last of the graph
+/// a '*' is a gear if it's between exactly two numbers
+/// numbers are labelled up front so a gear only has to count the distinct labels around it.
+/// Numbers in the rows just outside the band are labelled as a halo, their gears are not counted
+/// @param char buf
+/// @param how many elems
+/// @param width of graph
+/// @param first first row of the band
+/// @param last row after the band
+/// @param scratch arena the labels are taken from, the caller resets it
+/// @return sum
+uint32_t gear_ratio_band(const char *buf, size_t count, size_t width, size_t first, size_t last, Arena *scratch) {
+    size_t lo = first ? first - 1 : 0;
+    size_t hi = last + 1;
+    const char *halo = buf + lo * width;
+    const char *band = buf + (first * width < count ? first * width : count);
+    const char *end = buf + (hi * width < count ? hi * width : count);
+    const char *band_end = buf + (last * width < count ? last * width : count);
+    NumberLabels labels;
+    uint32_t sum = 0;
+    uint32_t seen[8];
+    uint32_t n_around, id;
+    size_t j, k;
+    const uint32_t *cell;
+    const char *gear;
+
+    const ptrdiff_t around[8] = {
+        -(ptrdiff_t)width - 1, -(ptrdiff_t)width, -(ptrdiff_t)width + 1,
+        -1,                                       1,
+        (ptrdiff_t)width - 1,  (ptrdiff_t)width,  (ptrdiff_t)width + 1,
+    };
+
+    label_numbers(halo, end - halo, width, &labels, scratch);
+
+    for (gear = memchr(band, '*', band_end - band);
+         gear;
+         gear = memchr(gear + 1, '*', band_end - gear - 1))
+    {
+        cell = labels.label + (gear - halo);
+        n_around = 0;
 
-    start = &num_buf[num_buf_offset + i + 1]; // start of valid number
-    uint32_t ret = strtoul(start, NULL, 10);
+        for (j = 0; j < 8; j++) {
+            id = cell[around[j]];
+            if (id == 0)
+                continue;
 
-    free(num_buf);
+            for (k = 0; k < n_around && seen[k] != id; k++);
+            if (k == n_around)
+                seen[n_around++] = id;
+        }
 
-    return ret;
+        if (n_around == 2)
+            sum += labels.value[seen[0] - 1] * labels.value[seen[1] - 1];
+    }
+
+    return sum;
 }
 
 /// @brief find gear ratio
-/// a '*' is a gear if it's between exactly two numbers
-/// we gotta go full graph
 /// @param char buf
 /// @param how many elems
 /// @param width of graph
 /// @return sum
 uint32_t gear_ratio(const char *buf, size_t count, size_t width) {
-    uint32_t sum = 0;
-    uint32_t curr = 1;
-    uint32_t n_around = 0; // how many numbers around gear
-    size_t i = 0;
-    char c;
-
-    const size_t NW = -width - 1;  // northwest offset
-    const size_t N  = -width;      // north offset
-    const size_t NE = -width + 1;  // northeast offset
-                                   //
-    const size_t SW = width - 1;  // southwest offset
-    const size_t S  = width;      // south offset
-    const size_t SE = width + 1;  // southeast offset
-
-    // if bound is true then that attrib is ignored
-    // for example bound.above == true we don't check above the node
-    struct Bound {
-        bool above;
-        bool below;
-        bool left;
-        bool right;
-    } bound;
-
-    for (i = 0; i < count; i++) {
-        c = buf[i];
+    Arena scratch;
+    uint32_t ret;
 
-        if (c != '*') {
-            continue;
-        }
+    arena_init(&scratch, 0);
+    ret = gear_ratio_band(buf, count, width, 0, graph_rows(count, width), &scratch);
+    arena_free(&scratch);
 
-        bound = (struct Bound){
-            .above = i < width,
-            .below = i > count - width - 1,
-            .left = (i % width) == 0,
-            .right = (i % width) == width - 2, // account for nl
+    return ret;
+}
+
+/// @brief rows of the graph solved by one thread
+typedef struct Band {
+    const char *buf;    ///< whole graph
+    size_t count;       ///< how many elems
+    size_t width;       ///< width of graph
+    size_t first;       ///< first row of the band
+    size_t last;        ///< row after the band
+    uint32_t sum;       ///< part numbers of the band
+    uint32_t gear;      ///< gear ratios of the band
+} Band;
+
+/// @brief thread entry, solves both parts for one band
+static void *solve_band(void *arg) {
+    Band *band = arg;
+    Arena scratch;
+
+    // every thread has its own arena, nothing in it is shared
+    arena_init(&scratch, 0);
+    band->sum = sum_band(band->buf, band->count, band->width, band->first, band->last, &scratch);
+    band->gear = gear_ratio_band(band->buf, band->count, band->width, band->first, band->last, &scratch);
+    arena_free(&scratch);
+
+    return NULL;
+}
+
+/// @brief query how many threads to run, AOC_THREADS overrides the number of cores
+/// @return thread count, at least 1
+size_t thread_count(void) {
+    const char *env = getenv("AOC_THREADS");
+    long n = env ? strtol(env, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+
+    return n > 0 ? (size_t)n : 1;
+}
+
+/// @brief solve both parts with the graph split into one band of rows per thread
+/// each band reads one halo row above and below but only counts what is in its own rows
+/// @param char buf
+/// @param how many elems
+/// @param width of graph
+/// @param n_threads threads to use, fewer are used when the graph is small
+/// @param sum part numbers of the graph
+/// @param gear gear ratios of the graph
+void solve_parallel(
+    const char *buf,
+    size_t count,
+    size_t width,
+    size_t n_threads,
+    uint32_t *sum,
+    uint32_t *gear
+) {
+    size_t rows = graph_rows(count, width);
+    Band *bands;
+    pthread_t *threads;
+    size_t i;
+    int err;
+
+    if (n_threads > rows / BAND_MIN + 1)
+        n_threads = rows / BAND_MIN + 1;
+
+    bands = calloc(n_threads, sizeof(*bands));
+    threads = calloc(n_threads, sizeof(*threads));
+    assert(bands && threads);
+
+    for (i = 0; i < n_threads; i++) {
+        bands[i] = (Band){
+            .buf = buf,
+            .count = count,
+            .width = width,
+            .first = rows * i / n_threads,
+            .last = rows * (i + 1) / n_threads,
         };
+    }
 
-        n_around = 0;
-        curr = 1; // current ratio
+    // the calling thread takes the first band
+    for (i = 1; i < n_threads; i++) {
+        err = pthread_create(&threads[i], NULL, solve_band, &bands[i]);
+        assert(err == 0);
+    }
+    solve_band(&bands[0]);
+
+    *sum = bands[0].sum;
+    *gear = bands[0].gear;
+    for (i = 1; i < n_threads; i++) {
+        pthread_join(threads[i], NULL);
+        *sum += bands[i].sum;
+        *gear += bands[i].gear;
+    }
+
+    free(threads);
+    free(bands);
+}
+
+/// @brief a number of the graph and where it sits
+typedef struct Span {
+    uint32_t row;       ///< row of the number
+    uint32_t first;     ///< column of its first digit
+    uint32_t last;      ///< column of its last digit
+    uint32_t value;     ///< parsed value
+} Span;
+
+/// @brief a symbol of the graph and where it sits
+typedef struct Symbol {
+    uint32_t row;       ///< row of the symbol
+    uint32_t col;       ///< column of the symbol
+    char c;             ///< the symbol
+} Symbol;
+
+/// @brief only the non '.' cells of a graph
+/// spans are in reading order and bucketed by row so the numbers next to a cell are found with
+/// a binary search of at most three rows
+typedef struct SparseGraph {
+    Span *spans;        ///< every number
+    Symbol *symbols;    ///< every symbol
+    size_t *row_spans;  ///< spans of row r are row_spans[r] up to row_spans[r + 1]
+    size_t n_spans;     ///< numbers found
+    size_t n_symbols;   ///< symbols found
+    size_t n_rows;      ///< rows of the graph
+} SparseGraph;
+
+/// @brief find the next cell of a row that isn't a '.'
+/// @param row first cell of the row
+/// @param c column to start at
+/// @param cols cells in the row
+/// @return column of the cell or cols if there is none
+static size_t skip_dots(const char *row, size_t c, size_t cols) {
+#ifdef __SSE2__
+    for (; c + 16 <= cols; c += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(row + c));
+        uint32_t mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('.'))) & 0xFFFF;
+
+        if (mask)
+            return c + __builtin_ctz(mask);
+    }
+#endif
+
+    while (c < cols && row[c] == '.')
+        c++;
 
-        if (!bound.left && isdigit(buf[i - 1])) {
-            n_around++;
-            curr *= buf_to_uint(buf, width, i, -1);
+    return c;
+}
+
+/// @brief grow an array by doubling when it is full
+static void *grow(void *arr, size_t n, size_t *cap, size_t size) {
+    if (n < *cap)
+        return arr;
+
+    *cap = *cap ? *cap * 2 : 256;
+    arr = realloc(arr, *cap * size);
+    assert(arr);
+
+    return arr;
+}
+
+/// @brief collect the numbers and symbols of a graph, runs of '.' are skipped 16 at a time
+/// @param char buf
+/// @param how many elems
+/// @param width of graph
+/// @param graph filled in, free with free_sparse_graph
+void build_sparse_graph(const char *buf, size_t count, size_t width, SparseGraph *graph) {
+    size_t cols = width - 1;
+    size_t cap_spans = 0, cap_symbols = 0;
+    size_t r, c, first;
+    uint32_t curr;
+    const char *row;
+
+    memset(graph, 0, sizeof(*graph));
+    graph->n_rows = graph_rows(count, width);
+    graph->row_spans = calloc(graph->n_rows + 1, sizeof(size_t));
+    assert(graph->row_spans);
+
+    for (r = 0; r < graph->n_rows; r++) {
+        row = buf + r * width;
+        graph->row_spans[r] = graph->n_spans;
+
+        for (c = skip_dots(row, 0, cols); c < cols; c = skip_dots(row, c, cols)) {
+            if (!isdigit(row[c])) {
+                graph->symbols = grow(graph->symbols, graph->n_symbols, &cap_symbols, sizeof(Symbol));
+                graph->symbols[graph->n_symbols++] = (Symbol){ .row = r, .col = c, .c = row[c] };
+                c++;
+                continue;
+            }
+
+            for (first = c, curr = 0; c < cols && isdigit(row[c]); c++)
+                curr = curr * 10 + (row[c] - '0');
+
+            graph->spans = grow(graph->spans, graph->n_spans, &cap_spans, sizeof(Span));
+            graph->spans[graph->n_spans++] = (Span){
+                .row = r, .first = first, .last = c - 1, .value = curr,
+            };
         }
-        if (!bound.right && isdigit(buf[i + 1])) {
-            n_around++;
-            curr *= buf_to_uint(buf, width, i, 1);
+    }
+    graph->row_spans[graph->n_rows] = graph->n_spans;
+}
+
+/// @brief free a graph made by build_sparse_graph
+void free_sparse_graph(SparseGraph *graph) {
+    free(graph->spans);
+    free(graph->symbols);
+    free(graph->row_spans);
+    memset(graph, 0, sizeof(*graph));
+}
+
+/// @brief collect the numbers touching a cell
+/// @param graph sparse graph
+/// @param sym cell to look around
+/// @param near indices of the spans next to the cell, room for 6
+/// @return number of spans found
+static size_t spans_around(const SparseGraph *graph, const Symbol *sym, size_t near[6]) {
+    size_t n = 0;
+    size_t r, lo, hi, mid;
+
+    for (r = sym->row ? sym->row - 1 : 0; r <= sym->row + 1 && r < graph->n_rows; r++) {
+        // first span of the row that ends at or right of the column before the cell
+        lo = graph->row_spans[r];
+        hi = graph->row_spans[r + 1];
+        while (lo < hi) {
+            mid = lo + (hi - lo) / 2;
+            if (graph->spans[mid].last + 1 < sym->col)
+                lo = mid + 1;
+            else
+                hi = mid;
         }
-        if (!bound.above) {
-            // edge case (rest are exclusive)
-            // @ . @
-            // . . .
-            // . . .
-            if (!bound.left &&
-                !bound.right &&
-                isdigit(buf[i + NW])
-                && isdigit(buf[i + NE])
-                && !isdigit(buf[i + N]))
-            {
-                n_around += 2;
-                curr *= buf_to_uint(buf, width, i, NW);
-                curr *= buf_to_uint(buf, width, i, NE);
-            // NW
-            } else if (!bound.left && isdigit(buf[i + NW])) {
-                n_around++;
-                curr *= buf_to_uint(buf, width, i, NW);
-            // N
-            } else if (isdigit(buf[i + N])) {
-                n_around++;
-                curr *= buf_to_uint(buf, width, i, N);
-            // NE
-            } else if (!bound.right && isdigit(buf[i + NE])) {
-                n_around++;
-                curr *= buf_to_uint(buf, width, i, NE);
+
+        for (; lo < graph->row_spans[r + 1] && graph->spans[lo].first <= sym->col + 1; lo++)
+            near[n++] = lo;
+    }
+
+    return n;
+}
+
+/// @brief solve both parts from the sparse graph, the work scales with the non '.' cells
+/// @param graph sparse graph
+/// @param sum part numbers of the graph
+/// @param gear gear ratios of the graph
+void solve_sparse(const SparseGraph *graph, uint32_t *sum, uint32_t *gear) {
+    bool *part;
+    size_t near[6];
+    size_t i, j, n;
+
+    *sum = *gear = 0;
+
+    part = calloc(graph->n_spans + 1, sizeof(bool));
+    assert(part);
+
+    for (i = 0; i < graph->n_symbols; i++) {
+        n = spans_around(graph, &graph->symbols[i], near);
+
+        for (j = 0; j < n; j++)
+            part[near[j]] = true;
+
+        if (graph->symbols[i].c == '*' && n == 2)
+            *gear += graph->spans[near[0]].value * graph->spans[near[1]].value;
+    }
+
+    for (i = 0; i < graph->n_spans; i++) {
+        if (part[i])
+            *sum += graph->spans[i].value;
+    }
+
+    free(part);
+}
+
+/// @brief solve both parts from a stream holding only three rows at a time
+/// rows enter at the bottom of the window and are solved once the row below them has arrived,
+/// reusing the band kernels with the rows above and below as the halo, so memory is O(width)
+/// @param stream open stream
+/// @param scratch arena reset after every row, it stops growing once it fits a full window
+/// @param sum part numbers of the graph
+/// @param gear gear ratios of the graph
+/// @return 0 on success or -1 on read error or rows of different widths
+int solve_stream(ImportStream *stream, Arena *scratch, uint32_t *sum, uint32_t *gear) {
+    const char *line;
+    char *window = NULL;
+    size_t width = 0;
+    size_t n_rows = 0;
+    size_t total = 0;
+    bool blank = false;
+    ssize_t len;
+
+    *sum = *gear = 0;
+
+    while ((len = import_stream_line(stream, &line)) > 0) {
+        // one empty line may end the graph
+        if (blank || (total > 0 && len == 1 && *line == '\n' && width != 1)) {
+            if (blank) {
+                fprintf(stderr, "Rows of different width!\n");
+                len = -1;
+                break;
             }
+            blank = true;
+            continue;
         }
-        if (!bound.below) {
-            // edge case (rest are exclusive)
-            // . . .
-            // . . .
-            // @ . @
-            if (!bound.left &&
-                !bound.right &&
-                isdigit(buf[i + SW])
-                && isdigit(buf[i + SE])
-                && !isdigit(buf[i + S]))
-            {
-                n_around += 2;
-                curr *= buf_to_uint(buf, width, i, SW);
-                curr *= buf_to_uint(buf, width, i, SE);
-            // SW
-            } else if (!bound.left && isdigit(buf[i + SW])) {
-                n_around++;
-                curr *= buf_to_uint(buf, width, i, SW);
-            // S
-            } else if (isdigit(buf[i + S])) {
-                n_around++;
-                curr *= buf_to_uint(buf, width, i, S);
-            // SE
-            } else if (!bound.right && isdigit(buf[i + SE])) {
-                n_around++;
-                curr *= buf_to_uint(buf, width, i, SE);
-            }
+
+        if (window == NULL) {
+            width = len;
+            window = calloc(3 * width + 1, sizeof(char));
+            assert(window);
+        }
+
+        if ((size_t)len != width) {
+            fprintf(stderr, "Rows of different width!\n");
+            len = -1;
+            break;
         }
 
-        if (n_around == 2) {
-            sum += curr;
+        // slide the top row out
+        if (n_rows == 3) {
+            memmove(window, window + width, 2 * width);
+            n_rows--;
+        }
+
+        memcpy(window + n_rows * width, line, width);
+        n_rows++;
+        total++;
+
+        // the row above the new one is complete, the very first row has no row above it
+        if (n_rows == 3 || total == 2) {
+            *sum += sum_band(window, n_rows * width, width, n_rows - 2, n_rows - 1, scratch);
+            *gear += gear_ratio_band(window, n_rows * width, width, n_rows - 2, n_rows - 1, scratch);
+            arena_reset(scratch);
         }
     }
 
-    return sum;
-}
+    // the bottom row has no row below it
+    if (len == 0 && n_rows > 0) {
+        *sum += sum_band(window, n_rows * width, width, n_rows - 1, n_rows, scratch);
+        *gear += gear_ratio_band(window, n_rows * width, width, n_rows - 1, n_rows, scratch);
+        arena_reset(scratch);
+    }
 
-int main(void) {
-    char *buf;
-    ssize_t len;
+    free(window);
 
-    len = import("input.txt", NULL);
-    assert(len > 0);
+    return len < 0 ? -1 : 0;
+}
 
-    buf = calloc(len + 1, sizeof(char));
-    import("input.txt", buf);
-    assert(buf);
+/// @brief query width of an indexed graph, every row must be as wide as the first
+/// one empty line at the end isn't a row and is ignored
+/// @param lines index of the graph
+/// @return width, newline included, or 0 if the rows differ
+size_t graph_width_lines(const LineIndex *lines) {
+    size_t n_lines = lines->n_lines;
+    size_t width, len;
+
+    if (n_lines > 1 && line_length(lines, n_lines - 1) == 1 && *line_at(lines, n_lines - 1) == '\n')
+        n_lines--;
+    if (n_lines == 0)
+        return 0;
+
+    // a graph of one row may be missing its newline
+    width = line_length(lines, 0);
+    if (line_at(lines, 0)[width - 1] != '\n')
+        width++;
+
+    for (size_t i = 1; i < n_lines; i++) {
+        len = line_length(lines, i);
+
+        // so may the last row of any graph
+        if (len != width && !(i + 1 == n_lines && len == width - 1))
+            return 0;
+    }
 
-    size_t w = graph_width(buf);
+    return width;
+}
 
-    printf("sum: %u\n", sum(buf, len, w));
-    printf("gear: %d\n", gear_ratio(buf, len, w));
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "input.txt";
+    ImportView view;
+    ImportStream stream;
+    Arena scratch;
+    LineIndex lines;
+    ssize_t len;
+    uint32_t part_sum, gear;
+    int err;
+
+    if (import_is_file(path)) {
+        PROBE_BEGIN("import");
+        len = import_map(path, &view, IMPORT_HUGE_PAGES);
+        PROBE_END("import");
+        assert(len > 0);
+
+        PROBE_BEGIN("index");
+        line_index_build(view.buf, len, &lines);
+        size_t w = graph_width_lines(&lines);
+        // leave a trailing empty line out of the graph
+        if (lines.n_lines > 1 && line_length(&lines, lines.n_lines - 1) == 1 && view.buf[len - 1] == '\n')
+            len--;
+        line_index_free(&lines);
+        PROBE_END("index");
+        if (w == 0) {
+            fprintf(stderr, "Graph rows aren't all the same width!\n");
+            import_unmap(&view);
+            return 1;
+        }
+
+        // mostly empty graphs can be solved from their non '.' cells alone
+        PROBE_BEGIN("solve");
+        if (getenv("AOC_SPARSE")) {
+            SparseGraph graph;
+            build_sparse_graph(view.buf, len, w, &graph);
+            solve_sparse(&graph, &part_sum, &gear);
+            free_sparse_graph(&graph);
+        } else {
+            solve_parallel(view.buf, len, w, thread_count(), &part_sum, &gear);
+        }
+        PROBE_END("solve");
+
+        import_unmap(&view);
+    } else {
+        // pipes and stdin can't be mapped so read them a row at a time
+        PROBE_BEGIN("import");
+        err = import_stream_open(path, &stream, 0);
+        PROBE_END("import");
+        assert(err == 0);
+
+        // scratch memory of the solver, reused for every row
+        arena_init(&scratch, 0);
+
+        PROBE_BEGIN("stream");
+        err = solve_stream(&stream, &scratch, &part_sum, &gear);
+        PROBE_END("stream");
+
+        arena_free(&scratch);
+        import_stream_close(&stream);
+        if (err)
+            return 1;
+    }
 
-    free(buf);
+    printf("sum: %u\n", part_sum);
+    printf("gear: %d\n", gear);
 
     return 0;
 }
@@ -0,0 +1,26 @@
+#ifndef AOC_SCHEMATIC_H
+#define AOC_SCHEMATIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief query width of a char buf
+/// @param buf NULL terminated buffer
+/// @return width, newline included
+size_t graph_width(const char *buf);
+
+/// @brief sum the part numbers of the graph
+/// @param buf graph
+/// @param count number of chars in buf
+/// @param width width of graph
+/// @return sum
+uint32_t sum(const char *buf, size_t count, size_t width);
+
+/// @brief sum the gear ratios of the graph
+/// @param buf graph
+/// @param count number of chars in buf
+/// @param width width of graph
+/// @return sum
+uint32_t gear_ratio(const char *buf, size_t count, size_t width);
+
+#endif // AOC_SCHEMATIC_H
@@ -0,0 +1,187 @@
+#include "alloc.h"
+
+#ifdef AOC_ALLOC_TRACK
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+
+// the wrappers below call the real allocator
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+// call sites remembered, later ones are counted as other
+#define ALLOC_SITES 256
+
+// call sites printed at exit
+#define ALLOC_HOT_SITES 10
+
+// bytes in front of every block holding its size, keeps the block 16 byte aligned
+#define ALLOC_HEADER 16
+
+/// @brief everything allocated from one file and line
+typedef struct AllocSite {
+    const char *file;   ///< file of the call, NULL for an empty slot
+    int line;           ///< line of the call
+    uint64_t calls;     ///< allocations made
+    uint64_t bytes;     ///< bytes asked for
+} AllocSite;
+
+static AllocSite sites[ALLOC_SITES];
+static AllocSite other = { "other", 0, 0, 0 };
+static uint64_t n_allocs;
+static uint64_t n_frees;
+static uint64_t total_bytes;
+static uint64_t live_bytes;
+static uint64_t peak_bytes;
+static bool lock;
+static bool started;
+
+/// @brief spin until the tracker is ours, the solvers allocate from several threads
+static void acquire(void) {
+    while (__atomic_test_and_set(&lock, __ATOMIC_ACQUIRE));
+}
+
+static void release(void) {
+    __atomic_clear(&lock, __ATOMIC_RELEASE);
+}
+
+/// @brief qsort order for sites, most bytes first
+static int cmp_site_bytes(const void *a, const void *b) {
+    const AllocSite *x = a;
+    const AllocSite *y = b;
+
+    return (x->bytes < y->bytes) - (x->bytes > y->bytes);
+}
+
+/// @brief print the totals and the hottest call sites to stderr
+static void report(void) {
+    struct rusage usage;
+    size_t i, n;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(stderr, "allocs %lu, frees %lu, bytes %lu, peak live %lu, peak rss %ld KiB\n",
+            (unsigned long)n_allocs, (unsigned long)n_frees, (unsigned long)total_bytes,
+            (unsigned long)peak_bytes, usage.ru_maxrss);
+
+    for (i = n = 0; i < ALLOC_SITES; i++) {
+        if (sites[i].file)
+            sites[n++] = sites[i];
+    }
+    if (other.calls && n < ALLOC_SITES)
+        sites[n++] = other;
+    qsort(sites, n, sizeof(AllocSite), cmp_site_bytes);
+
+    fprintf(stderr, "%-24s %12s %14s\n", "site", "calls", "bytes");
+    for (i = 0; i < n && i < ALLOC_HOT_SITES; i++) {
+        fprintf(stderr, "%-18s:%-5d %12lu %14lu\n", sites[i].file, sites[i].line,
+                (unsigned long)sites[i].calls, (unsigned long)sites[i].bytes);
+    }
+}
+
+/// @brief count an allocation against its call site, caller holds the lock
+static void record(size_t size, const char *file, int line) {
+    size_t h = ((uintptr_t)file * 31 + line) % ALLOC_SITES;
+    size_t i;
+    AllocSite *site = &other;
+
+    if (!started) {
+        atexit(report);
+        started = true;
+    }
+
+    // open addressing on file and line
+    for (i = 0; i < ALLOC_SITES; i++, h = (h + 1) % ALLOC_SITES) {
+        if (sites[h].file == NULL) {
+            sites[h].file = file;
+            sites[h].line = line;
+        }
+        if (sites[h].file == file && sites[h].line == line) {
+            site = &sites[h];
+            break;
+        }
+    }
+
+    site->calls++;
+    site->bytes += size;
+    n_allocs++;
+    total_bytes += size;
+    live_bytes += size;
+    if (live_bytes > peak_bytes)
+        peak_bytes = live_bytes;
+}
+
+/// @brief size a block was made with
+static size_t block_size(void *p) {
+    return *(size_t *)((char *)p - ALLOC_HEADER);
+}
+
+/// @brief stamp the size in front of a fresh block and hand out the rest
+static void *finish_block(char *raw, size_t size, const char *file, int line) {
+    if (raw == NULL)
+        return NULL;
+
+    *(size_t *)raw = size;
+
+    acquire();
+    record(size, file, line);
+    release();
+
+    return raw + ALLOC_HEADER;
+}
+
+void *alloc_track_malloc(size_t size, const char *file, int line) {
+    return finish_block(malloc(size + ALLOC_HEADER), size, file, line);
+}
+
+void *alloc_track_calloc(size_t n, size_t size, const char *file, int line) {
+    if (size && n > (SIZE_MAX - ALLOC_HEADER) / size)
+        return NULL;
+
+    return finish_block(calloc(1, n * size + ALLOC_HEADER), n * size, file, line);
+}
+
+void *alloc_track_realloc(void *p, size_t size, const char *file, int line) {
+    size_t old = p ? block_size(p) : 0;
+    char *raw = realloc(p ? (char *)p - ALLOC_HEADER : NULL, size + ALLOC_HEADER);
+
+    if (raw == NULL)
+        return NULL;
+
+    *(size_t *)raw = size;
+
+    // a realloc counts as a free of the old block and a new allocation of the whole size
+    acquire();
+    if (p) {
+        n_frees++;
+        live_bytes -= old;
+    }
+    record(size, file, line);
+    release();
+
+    return raw + ALLOC_HEADER;
+}
+
+void alloc_track_free(void *p) {
+    if (p == NULL)
+        return;
+
+    acquire();
+    n_frees++;
+    live_bytes -= block_size(p);
+    release();
+
+    free((char *)p - ALLOC_HEADER);
+}
+
+#else
+
+// without AOC_ALLOC_TRACK there is nothing to build, ISO C still wants a declaration
+typedef int alloc_disabled;
+
+#endif // AOC_ALLOC_TRACK
@@ -1,33 +1,169 @@
 #include "import.h"
 
-ssize_t import(const char* path, char* buf) {
-    FILE* fp = NULL;
-    ssize_t fsize = -1;
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-    fp = fopen(path, "r");
-    if (fp == NULL) {
+#include "alloc.h"
+
+ssize_t import_map(const char* path, ImportView *view, int flags) {
+    struct stat st;
+    size_t page, len, map_len;
+    char *base = MAP_FAILED;
+    int fd;
+
+    memset(view, 0, sizeof(*view));
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
         fprintf(stderr, "File import error!\n");
-        goto abort;
+        return -1;
     }
 
-    fseek(fp, 0L, SEEK_END);
-    fsize = ftell(fp);
-    if (fsize < 0) {
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
         fprintf(stderr, "File read error!\n");
         goto abort;
     }
 
-    if (buf == NULL) {
+    // reserve one byte past the file rounded up to a page, the tail is anonymous
+    // zeroed memory so the view is always NULL terminated even on a page boundary
+    page = sysconf(_SC_PAGESIZE);
+    len = st.st_size;
+    map_len = (len + 1 + page - 1) & ~(page - 1);
+
+    base = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "File map error!\n");
+        goto abort;
+    }
+
+    if (len > 0 &&
+        mmap(base, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        fprintf(stderr, "File map error!\n");
+        munmap(base, map_len);
         goto abort;
     }
 
-    rewind(fp);
+    // advice is only a hint, failures are harmless
+    madvise(base, map_len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    if (flags & IMPORT_HUGE_PAGES)
+        madvise(base, map_len, MADV_HUGEPAGE);
+#else
+    (void)flags;
+#endif
 
-    if (fread(buf, sizeof(char), fsize, fp) != (size_t)fsize) {
-        fprintf(stderr, "Possible missing data!\n");
-    }
+    view->buf = base;
+    view->len = len;
+    view->map_len = map_len;
+
+    close(fd);
+    return len;
 
 abort:
-    fclose(fp);
-    return fsize;
+    close(fd);
+    return -1;
+}
+
+void import_unmap(ImportView *view) {
+    if (view->buf)
+        munmap((void *)view->buf, view->map_len);
+
+    memset(view, 0, sizeof(*view));
+}
+
+bool import_is_file(const char* path) {
+    struct stat st;
+
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+int import_stream_open(const char* path, ImportStream *stream, size_t cap) {
+    memset(stream, 0, sizeof(*stream));
+
+    stream->cap = cap ? cap : IMPORT_STREAM_CAP;
+    stream->fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    if (stream->fd < 0) {
+        fprintf(stderr, "File import error!\n");
+        return -1;
+    }
+
+    // two spare bytes so the last line can always get a "\n\0" appended
+    stream->buf = calloc(stream->cap + 2, sizeof(char));
+    if (stream->buf == NULL) {
+        fprintf(stderr, "Stream alloc error!\n");
+        import_stream_close(stream);
+        return -1;
+    }
+
+    return 0;
+}
+
+ssize_t import_stream_line(ImportStream *stream, const char **line) {
+    char *nl;
+    ssize_t n;
+    size_t len;
+
+    // undo the terminator written after the previous line
+    stream->buf[stream->head] = stream->held;
+
+    for (;;) {
+        nl = memchr(stream->buf + stream->head, '\n', stream->tail - stream->head);
+        if (nl != NULL)
+            break;
+
+        if (stream->eof) {
+            if (stream->head == stream->tail)
+                return 0;
+
+            // final line without a newline
+            nl = &stream->buf[stream->tail++];
+            *nl = '\n';
+            break;
+        }
+
+        // carry the partial line to the front and refill behind it
+        if (stream->head > 0) {
+            memmove(stream->buf, stream->buf + stream->head, stream->tail - stream->head);
+            stream->tail -= stream->head;
+            stream->head = 0;
+        }
+
+        if (stream->tail == stream->cap) {
+            fprintf(stderr, "Line exceeds stream buffer!\n");
+            return -1;
+        }
+
+        n = read(stream->fd, stream->buf + stream->tail, stream->cap - stream->tail);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "File read error!\n");
+            return -1;
+        }
+
+        stream->eof = n == 0;
+        stream->tail += n;
+    }
+
+    *line = stream->buf + stream->head;
+    len = nl - *line + 1;
+    stream->head += len;
+    stream->held = stream->buf[stream->head];
+    stream->buf[stream->head] = '\0';
+
+    return len;
+}
+
+void import_stream_close(ImportStream *stream) {
+    if (stream->fd > STDIN_FILENO)
+        close(stream->fd);
+
+    free(stream->buf);
+    memset(stream, 0, sizeof(*stream));
 }
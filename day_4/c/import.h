@@ -1,12 +1,69 @@
 #ifndef AOC_IMPORT_H
 #define AOC_IMPORT_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 
-/// @brief import a file to buffer
+/// @brief ask the kernel to back the mapping with huge pages, best effort
+#define IMPORT_HUGE_PAGES 0x1
+
+/// @brief default buffer size of a stream, also the longest line it can hold
+#define IMPORT_STREAM_CAP (1 << 20)
+
+/// @brief read-only view of a file mapped into memory
+typedef struct ImportView {
+    const char *buf;    ///< file contents, always followed by at least one '\0'
+    size_t len;         ///< file length not counting the terminator
+    size_t map_len;     ///< length of the whole mapping
+} ImportView;
+
+/// @brief fixed memory line reader for pipes and inputs too big to map
+/// a line cut off at the end of a chunk is carried to the front of the buffer and completed
+/// by the next read, so memory use is bounded by cap regardless of input size
+typedef struct ImportStream {
+    char *buf;      ///< cap bytes plus room for a terminating "\n\0"
+    size_t cap;     ///< max bytes held at once
+    size_t head;    ///< start of unread data
+    size_t tail;    ///< end of valid data
+    char held;      ///< byte overwritten by the last line's terminator
+    bool eof;       ///< no more reads to do
+    int fd;         ///< source, 0 for stdin
+} ImportStream;
+
+/// @brief map a file read-only without copying it
+/// the view is NULL terminated so it can be handed straight to the solvers
 /// @param path path of file
-/// @param buf this is the buffer to file. If NULL the function just returns the file length
-/// @return file length
-ssize_t import(const char* path, char* buf);
+/// @param view filled in on success
+/// @param flags 0 or IMPORT_HUGE_PAGES
+/// @return file length or -1 on error
+ssize_t import_map(const char* path, ImportView *view, int flags);
+
+/// @brief release a view made by import_map
+/// @param view view to release, zeroed afterwards
+void import_unmap(ImportView *view);
+
+/// @brief query if a path can be mapped, pipes and "-" can only be streamed
+/// @param path path of file
+/// @return true for regular files
+bool import_is_file(const char* path);
+
+/// @brief open a stream over a file, pipe or "-" for stdin
+/// @param path path of file
+/// @param stream filled in on success
+/// @param cap buffer size, 0 picks IMPORT_STREAM_CAP
+/// @return 0 on success or -1 on error
+int import_stream_open(const char* path, ImportStream *stream, size_t cap);
+
+/// @brief get the next line of a stream
+/// the line always ends in "\n\0" and is valid until the next call
+/// @param stream open stream
+/// @param line set to the start of the line
+/// @return line length including the newline, 0 at end of input or -1 on error
+ssize_t import_stream_line(ImportStream *stream, const char **line);
+
+/// @brief close a stream made by import_stream_open
+/// @param stream stream to close, zeroed afterwards
+void import_stream_close(ImportStream *stream);
 
 #endif // AOC_IMPORT_H
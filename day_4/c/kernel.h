@@ -0,0 +1,55 @@
+// card matching of day 4, main.c includes this once per cpu tier
+// each copy is built under that tier's #pragma GCC target and named through KERNEL(name), the
+// scalar tier is built with no pragma at all. The code is the same in every tier, what changes
+// is the instructions the compiler may use, most of all a popcnt for the bitset match count
+
+/// @brief add columns of numbers to a bitset
+/// @param p first char of the first column
+/// @param n number of columns
+/// @param digits chars per column
+/// @param limit one past the largest number, larger ones are left out of the bitset
+/// @param set bitset with room for limit bits
+/// @return whether every column held only digits and spaces
+static bool KERNEL(add_columns)(const char *p, size_t n, size_t digits, size_t limit, uint64_t *set) {
+    uint32_t vals[COLUMN_BATCH];
+    size_t i, batch;
+    bool valid = true;
+
+    for (; n > 0; n -= batch, p += batch * (digits + 1)) {
+        batch = n < COLUMN_BATCH ? n : COLUMN_BATCH;
+        valid &= swar_parse_columns(p, batch, digits, vals);
+
+        for (i = 0; i < batch; i++) {
+            if (vals[i] < limit)
+                set[vals[i] >> 6] |= (uint64_t)1 << (vals[i] & 63);
+        }
+    }
+
+    return valid;
+}
+
+/// @brief count how many of a card's winning numbers were tried
+/// the numbers sit in fixed width columns so they are parsed a word at a time, then both
+/// sides of the card become a bitset so matching is an AND and a popcount
+/// @param layout layout of the deck
+/// @param s string Card N: N N N | N N N N N N
+/// @return number of matches or CARD_INVALID if a number column isn't digits and spaces
+uint32_t KERNEL(card_matches)(const CardLayout *layout, const char *s) {
+    uint64_t winners[SET_WORDS];
+    uint64_t tries[SET_WORDS];
+    uint32_t matches = 0;
+    size_t i;
+
+    memset(winners, 0, layout->words * sizeof(uint64_t));
+    memset(tries, 0, layout->words * sizeof(uint64_t));
+
+    // anything but digits and spaces would parse to a number the columns can't hold
+    if (!KERNEL(add_columns)(s + layout->winners_at, layout->n_winners, layout->digits, layout->limit, winners) ||
+        !KERNEL(add_columns)(s + layout->tries_at, layout->n_tries, layout->digits, layout->limit, tries))
+        return CARD_INVALID;
+
+    for (i = 0; i < layout->words; i++)
+        matches += __builtin_popcountll(winners[i] & tries[i]);
+
+    return matches;
+}
@@ -5,190 +5,515 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include "alloc.h"
+#include "cpu.h"
 #include "import.h"
+#include "lines.h"
+#include "probe.h"
+#include "scratchcards.h"
+#include "swar.h"
+
+// widest number column a deck may use, bitsets cover every value it can hold
+#define MAX_DIGITS 4
+#define SET_WORDS (10000 / 64 + 1)
+
+// card_matches of a card with something other than digits and spaces in its number columns
+#define CARD_INVALID UINT32_MAX
+
+// columns parsed per batch
+#define COLUMN_BATCH 48
+
+/// @brief shape of every card in a deck, read off the first card
+/// Card   1: 36 15 12 | 86 34 88  7 36
+typedef struct CardLayout {
+    size_t winners_at;  ///< offset of the first winning number column
+    size_t tries_at;    ///< offset of the first tried number column
+    size_t n_winners;   ///< winning numbers per card
+    size_t n_tries;     ///< tried numbers per card
+    size_t digits;      ///< chars per number column
+    size_t limit;       ///< one past the largest number of this width
+    size_t words;       ///< bitset words that hold any number of this width
+} CardLayout;
+
+/// @brief count the number columns in a span of a card
+static size_t count_columns(const char *p, const char *end) {
+    size_t n = 0;
+
+    for (; p < end; p++) {
+        if (*p != ' ' && (p[-1] == ' ' || p[-1] == ':' || p[-1] == '|'))
+            n++;
+    }
+
+    return n;
+}
+
+/// @brief work out the layout of a deck from one of its cards
+/// the cards must use right aligned fixed width columns, one space apart
+/// @param s string Card N: N N N | N N N N N N ending in '\n' or '\0'
+/// @param layout filled in on success
+/// @return 0 on success or -1 if the card isn't laid out in columns
+int detect_card_layout(const char *s, CardLayout *layout) {
+    const char *colon = strchr(s, ':');
+    const char *bar = colon ? strchr(colon, '|') : NULL;
+    const char *eol = s + strcspn(s, "\n");
+    size_t i;
+
+    memset(layout, 0, sizeof(*layout));
+    if (bar == NULL || bar > eol) {
+        fprintf(stderr, "Card has no number sides!\n");
+        return -1;
+    }
+
+    layout->n_winners = count_columns(colon + 1, bar);
+    layout->n_tries = count_columns(bar + 1, eol);
+    if (layout->n_winners == 0 || layout->n_tries == 0) {
+        fprintf(stderr, "Card has an empty side!\n");
+        return -1;
+    }
+
+    // " 36 15 12 " before the bar and " 86 34 88  7 36" after it
+    layout->digits = (bar - colon - 2) / layout->n_winners - 1;
+    if (layout->digits == 0 ||
+        layout->digits > MAX_DIGITS ||
+        (size_t)(bar - colon - 1) != layout->n_winners * (layout->digits + 1) + 1 ||
+        (size_t)(eol - bar - 1) != layout->n_tries * (layout->digits + 1))
+    {
+        fprintf(stderr, "Card numbers aren't in columns!\n");
+        return -1;
+    }
+
+    layout->winners_at = colon - s + 2;
+    layout->tries_at = bar - s + 2;
+    for (i = 0, layout->limit = 1; i < layout->digits; i++)
+        layout->limit *= 10;
+    layout->words = layout->limit / 64 + 1;
+
+    return 0;
+}
+
+#define KERNEL(name) name##_scalar
+#include "kernel.h"
+#undef KERNEL
+
+#ifdef CPU_DISPATCH
+#pragma GCC push_options
+#pragma GCC target("sse4.2,popcnt")
+#define KERNEL(name) name##_sse42
+#include "kernel.h"
+#undef KERNEL
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2,bmi,bmi2,popcnt")
+#define KERNEL(name) name##_avx2
+#include "kernel.h"
+#undef KERNEL
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx2,bmi,bmi2,popcnt")
+#define KERNEL(name) name##_avx512
+#include "kernel.h"
+#undef KERNEL
+#pragma GCC pop_options
+#endif
+
+/// @brief card matching of the running cpu's tier, picked before main runs
+static uint32_t (*matches_kernel)(const CardLayout *, const char *) = card_matches_scalar;
+
+/// @brief point the kernels at the best tier the cpu has, AOC_CPU can force a lower one
+__attribute__((constructor))
+static void select_kernels(void) {
+#ifdef CPU_DISPATCH
+    switch (cpu_tier()) {
+    case CPU_AVX512: matches_kernel = card_matches_avx512; break;
+    case CPU_AVX2:   matches_kernel = card_matches_avx2; break;
+    case CPU_SSE42:  matches_kernel = card_matches_sse42; break;
+    default:         break;
+    }
+#endif
+}
+
+/// @brief count how many of a card's winning numbers were tried
+/// @param layout layout of the deck
+/// @param s string Card N: N N N | N N N N N N
+/// @return number of matches or CARD_INVALID if a number column isn't digits and spaces
+uint32_t card_matches(const CardLayout *layout, const char *s) {
+    return matches_kernel(layout, s);
+}
+
+/// @brief report a card whose number columns hold something other than digits and spaces
+static int invalid_card(void) {
+    fprintf(stderr, "Card numbers aren't digits!\n");
+    return -1;
+}
 
-// offset of the metadata tag on the cards
-#define INPUT_OFFSET 9
+/// @brief score of a card from its number of matches, doubling past 32 matches wraps to 0
+static uint32_t card_score(uint32_t matches) {
+    return matches && matches <= 32 ? (uint32_t)1 << (matches - 1) : 0;
+}
 
 /// @brief evaluate winning state of a scratcher
 /// @param s NULL terminated string Card N: N N N | N N N N N N \0'
 /// @return the score
 uint32_t evaluate_card(const char *s) {
-    char *scpy, *tok, *saveptr;
-    uint32_t score = 0;
-    uint16_t winners[10], tries[25];
-    bool winning_numbers = true;
-    size_t i = 0;
-    size_t j = 0;
-
-    scpy = calloc(strlen(s) + 1, sizeof(*s));
-    assert(scpy);
-    strcpy(scpy, s);
-
-    tok = strtok_r(scpy + INPUT_OFFSET, " ", &saveptr);
-
-    while (tok != NULL) {
-        if (*tok == '|') {
-            winning_numbers = false;
-            i = 0;
-        } else {
-            uint16_t val = (uint16_t)strtoul(tok, NULL, 0);
-            if (winning_numbers)
-                winners[i] = val;
-            else
-                tries[i] = val;
-            i++;
-        }
-        tok = strtok_r(NULL, " ", &saveptr);
+    CardLayout layout;
+
+    uint32_t matches;
+
+    if (detect_card_layout(s, &layout) < 0)
+        return 0;
+
+    matches = card_matches(&layout, s);
+    return matches == CARD_INVALID ? 0 : card_score(matches);
+}
+
+/// @brief work out the layout of a deck from its first card, blank lines aren't cards
+/// @param lines index of the deck
+/// @param layout filled in on success
+/// @return 0 on success or -1 if there is no card or it isn't laid out in columns
+static int detect_deck_layout(const LineIndex *lines, CardLayout *layout) {
+    for (size_t i = 0; i < lines->n_lines; i++) {
+        if (*line_at(lines, i) != '\n')
+            return detect_card_layout(line_at(lines, i), layout);
     }
 
-    for (i = 0; i < 10; i++) {
-        for (j = 0; j < 25; j++) {
-            if (tries[j] == winners[i]) {
-                score = score ? score << 1 : 1;
-                break;
-            }
+    return -1;
+}
+
+/// @brief length of every card of a deck, newline included
+static size_t card_length(const CardLayout *layout) {
+    return layout->tries_at + layout->n_tries * (layout->digits + 1);
+}
+
+/// @brief query if a line of a deck is laid out like the first card
+/// every line must be as long as the first, otherwise its columns would be misread. The last
+/// line may be one short when the deck doesn't end in a newline
+/// @param lines index of the deck
+/// @param i line to check
+/// @param layout layout of the deck
+/// @return whether the card can be read with layout
+static bool card_in_columns(const LineIndex *lines, size_t i, const CardLayout *layout) {
+    size_t len = line_length(lines, i);
+
+    if (len == card_length(layout))
+        return true;
+
+    return i + 1 == lines->n_lines && len + 1 == card_length(layout) && line_at(lines, i)[len - 1] != '\n';
+}
+
+/// @brief sum the winning scores of every card of an indexed deck
+/// @param lines index of the deck
+/// @param score filled in on success
+/// @return 0 on success or -1 if a card isn't laid out like the first
+int score_deck(const LineIndex *lines, uint32_t *score) {
+    CardLayout layout;
+    uint32_t matches;
+
+    *score = 0;
+    if (detect_deck_layout(lines, &layout) < 0)
+        return -1;
+
+    for (size_t i = 0; i < lines->n_lines; i++) {
+        if (*line_at(lines, i) == '\n')
+            continue;
+
+        if (!card_in_columns(lines, i, &layout)) {
+            fprintf(stderr, "Card numbers aren't in columns!\n");
+            return -1;
         }
-    }
 
-    free(scpy);
+        matches = card_matches(&layout, line_at(lines, i));
+        if (matches == CARD_INVALID)
+            return invalid_card();
+        *score += card_score(matches);
+    }
 
-    return score;
+    return 0;
 }
 
 /// @brief split cards by nl and sum the winning scores of each row
 /// @param buf char buffer of scratcher data
 /// @param count number of chars in buf
-/// @return score
+/// @return score, 0 if the cards aren't laid out in columns
 uint32_t evaluate_cards(const char *buf, size_t count) {
-    char *s, *tok, *saveptr;
-    uint32_t score = 0;
+    LineIndex lines;
+    uint32_t score;
 
-    s = calloc(count + 1, sizeof(*buf));
-    assert(s);
-    strncpy(s, buf, count);
+    line_index_build(buf, count, &lines);
+    if (score_deck(&lines, &score) < 0)
+        score = 0;
+    line_index_free(&lines);
 
-    tok = strtok_r(s, "\n", &saveptr);
+    return score;
+}
 
-    while (tok != NULL) {
-        score += evaluate_card(tok);
-        tok = strtok_r(NULL, "\n", &saveptr);
-    }
+/// @brief count the matches of every card in a run of lines
+/// no card depends on another so a deck can be split into shards of lines and counted in parallel
+/// @param lines index of the deck
+/// @param first first line of the run
+/// @param last line after the run
+/// @param layout layout of the deck
+/// @param matches room for one count per card
+/// @return number of cards or -1 if a card isn't laid out like the first
+ssize_t count_card_matches(
+    const LineIndex *lines,
+    size_t first,
+    size_t last,
+    const CardLayout *layout,
+    uint32_t *matches
+) {
+    ssize_t n = 0;
+
+    for (size_t i = first; i < last; i++) {
+        if (*line_at(lines, i) == '\n')
+            continue;
+
+        if (!card_in_columns(lines, i, layout)) {
+            fprintf(stderr, "Card numbers aren't in columns!\n");
+            return -1;
+        }
 
-    free(s);
+        matches[n] = card_matches(layout, line_at(lines, i));
+        if (matches[n++] == CARD_INVALID)
+            return invalid_card();
+    }
 
-    return score;
+    return n;
 }
 
-/// @brief evaluate winning state of a scratcher tracked now as the number of times won
-/// @param s NULL terminated string Card N: N N N | N N N N N N \0'
-/// @return the score
-uint32_t evaluate_card_part_2(const char *s) {
-    char *scpy, *tok, *saveptr;
-    uint32_t score = 0;
-    uint16_t winners[10], tries[25];
-    bool winning_numbers = true;
-    size_t i = 0;
-    size_t j = 0;
-
-    scpy = calloc(strlen(s) + 1, sizeof(*s));
-    assert(scpy);
-    strcpy(scpy, s);
-
-    tok = strtok_r(scpy + INPUT_OFFSET, " ", &saveptr);
-
-    while (tok != NULL) {
-        if (*tok == '|') {
-            winning_numbers = false;
-            i = 0;
-        } else {
-            uint16_t val = (uint16_t)strtoul(tok, NULL, 0);
-            if (winning_numbers)
-                winners[i] = val;
-            else
-                tries[i] = val;
-            i++;
+/// @brief total number of cards once every card has won its copies
+/// copies are handed out with a difference array, a card that wins adds its copies at the
+/// start of the run it wins and takes them off after it, so each card is O(1) however far it
+/// reaches. Counts are unsigned so the subtraction, and a deck of more than 2^64 cards, wrap
+/// modulo 2^64 instead of overflowing
+/// @param matches matches of every card
+/// @param n_cards number of cards
+/// @return number of cards
+uint64_t propagate_cards(const uint32_t *matches, size_t n_cards) {
+    uint64_t *diff;
+    uint64_t running = 0;
+    uint64_t total = 0;
+    uint64_t copies;
+    size_t i, stop;
+
+    diff = calloc(n_cards + 1, sizeof(uint64_t));
+    assert(diff);
+
+    for (i = 0; i < n_cards; i++) {
+        running += diff[i];
+        copies = 1 + running;
+        total += copies;
+
+        if (matches[i]) {
+            stop = i + 1 + matches[i] < n_cards ? i + 1 + matches[i] : n_cards;
+            diff[i + 1] += copies;
+            diff[stop] -= copies;
         }
-        tok = strtok_r(NULL, " ", &saveptr);
     }
 
-    for (i = 0; i < 10; i++) {
-        for (j = 0; j < 25; j++) {
-            if (tries[j] == winners[i]) {
-                score++;
-                break;
-            }
-        }
+    free(diff);
+
+    return total;
+}
+
+/// @brief the difference array for a stream, as a ring
+/// a card can win at most one copy of each of the next n_winners cards so that many slots plus
+/// the current one are all we ever need
+typedef struct CardWindow {
+    uint64_t *diff;     ///< change in copies at each upcoming card, the current card is at head
+    uint64_t running;   ///< extra copies of the current card
+    size_t size;        ///< slots in the ring
+    size_t head;        ///< slot of the current card
+} CardWindow;
+
+/// @brief make a window for a deck
+/// @param window window to fill in, free with free_card_window
+/// @param layout layout of the deck
+void init_card_window(CardWindow *window, const CardLayout *layout) {
+    window->size = layout->n_winners + 1;
+    window->head = 0;
+    window->running = 0;
+    window->diff = calloc(window->size, sizeof(uint64_t));
+    assert(window->diff);
+}
+
+/// @brief free a window made by init_card_window
+void free_card_window(CardWindow *window) {
+    free(window->diff);
+    memset(window, 0, sizeof(*window));
+}
+
+/// @brief take the copies of the current card and hand its wins to the next cards
+/// @param window copies of the upcoming cards
+/// @param val number of wins of the current card, at most n_winners
+/// @return number of copies of the current card
+uint64_t tally_card(CardWindow *window, uint32_t val) {
+    uint64_t n_cards;
+
+    window->running += window->diff[window->head];
+    window->diff[window->head] = 0;
+    n_cards = 1 + window->running;
+
+    if (val) {
+        window->diff[(window->head + 1) % window->size] += n_cards;
+        window->diff[(window->head + 1 + val) % window->size] -= n_cards;
     }
 
-    free(scpy);
+    window->head = window->head + 1 == window->size ? 0 : window->head + 1;
 
-    return score;
+    return n_cards;
 }
 
-/// @brief slide our stack by one and replace the last val with 1
-/// [1, 2, 3, 4, 5, 6, 7, 8, 9] -> [2, 3, 4, 5, 6, 7, 8, 9, 1]
-/// @param stack stack of 10
-void slide_stack(uint32_t stack[10]) {
-    int i;
-    for (i = 0; i < 10 - 1; i++)
-        stack[i] = stack[i + 1];
-    stack[i] = 1;
+/// @brief total number of cards won by an indexed deck
+/// matches are all counted first, then the copies are handed out in one O(n) pass
+/// @param lines index of the deck
+/// @param total filled in on success
+/// @return 0 on success or -1 if a card isn't laid out like the first
+int count_deck(const LineIndex *lines, uint64_t *total) {
+    CardLayout layout;
+    uint32_t *matches;
+    ssize_t n_cards;
+
+    *total = 0;
+    if (detect_deck_layout(lines, &layout) < 0)
+        return -1;
+
+    matches = calloc(lines->n_lines + 1, sizeof(uint32_t));
+    assert(matches);
+
+    n_cards = count_card_matches(lines, 0, lines->n_lines, &layout, matches);
+    if (n_cards >= 0)
+        *total = propagate_cards(matches, n_cards);
+
+    free(matches);
+
+    return n_cards < 0 ? -1 : 0;
 }
 
 /// @brief split cards by nl and track the wins
 /// if Card 1 get 4 wins then we earn 4 more scratches, a Card 2, 3, 4, and 5 (totals 4)
-/// we then track these cards as they snowball to see the total number of cards gotten
+/// we then track these cards as they snowball to see the total number of cards gotten.
 /// @param buf char buffer of scratcher data
 /// @param count number of chars in buf
-/// @return number of cards
-uint32_t evaluate_cards_part_2(const char *buf, size_t count) {
-    char *s, *tok, *saveptr;
-    uint32_t score = 0;
-    size_t i;
+/// @return number of cards, 0 if the cards aren't laid out in columns
+uint64_t evaluate_cards_part_2(const char *buf, size_t count) {
+    LineIndex lines;
+    uint64_t total;
 
-    uint32_t stack[10];
-    for (i = 0; i < 10; i++)
-        stack[i] = 1;
+    line_index_build(buf, count, &lines);
+    if (count_deck(&lines, &total) < 0)
+        total = 0;
+    line_index_free(&lines);
 
-    s = calloc(count + 1, sizeof(*buf));
-    assert(s);
-    strncpy(s, buf, count);
+    return total;
+}
+
+/// @brief score both parts one card at a time so any size of deck runs in fixed memory
+/// @param stream open stream
+/// @param score score of part one
+/// @param n_cards number of cards of part two
+/// @return 0 on success or -1 on read error or a card that isn't laid out like the first
+int evaluate_cards_stream(ImportStream *stream, uint32_t *score, uint64_t *n_cards) {
+    const char *line;
+    ssize_t len;
+    CardLayout layout;
+    CardWindow window = { 0 };
+    bool first = true;
+    uint32_t matches;
 
-    tok = strtok_r(s, "\n", &saveptr);
+    *score = *n_cards = 0;
 
-    while (tok != NULL) {
-        uint32_t val = evaluate_card_part_2(tok);
-        uint32_t n_cards = stack[0];
-        slide_stack(stack);
-        for (i = 0; i < val; i++) {
-            stack[i] += n_cards;
+    while ((len = import_stream_line(stream, &line)) > 0) {
+        // blank lines aren't cards, same as the mapped path
+        if (*line == '\n')
+            continue;
+
+        if (first) {
+            if (detect_card_layout(line, &layout) < 0) {
+                len = -1;
+                break;
+            }
+            init_card_window(&window, &layout);
+            first = false;
+        }
+
+        // every line must be as long as the first, otherwise its columns would be misread
+        if ((size_t)len != card_length(&layout)) {
+            fprintf(stderr, "Card numbers aren't in columns!\n");
+            len = -1;
+            break;
         }
-        score += n_cards;
 
-        tok = strtok_r(NULL, "\n", &saveptr);
+        matches = card_matches(&layout, line);
+        if (matches == CARD_INVALID) {
+            len = invalid_card();
+            break;
+        }
+        *score += card_score(matches);
+        *n_cards += tally_card(&window, matches);
     }
 
-    free(s);
+    free_card_window(&window);
 
-    return score;
+    return len < 0 ? -1 : 0;
 }
 
-int main(void) {
-    char *buf;
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "input.txt";
+    ImportView view;
+    ImportStream stream;
+    LineIndex lines;
     ssize_t len;
+    uint32_t score;
+    uint64_t n_cards;
+    int err;
+
+    if (import_is_file(path)) {
+        PROBE_BEGIN("import");
+        len = import_map(path, &view, IMPORT_HUGE_PAGES);
+        PROBE_END("import");
+        assert(len > 0);
+
+        // both parts share one index of the deck
+        PROBE_BEGIN("index");
+        line_index_build(view.buf, len, &lines);
+        PROBE_END("index");
+
+        PROBE_BEGIN("part 1");
+        err = score_deck(&lines, &score);
+        PROBE_END("part 1");
+
+        if (err == 0) {
+            PROBE_BEGIN("part 2");
+            err = count_deck(&lines, &n_cards);
+            PROBE_END("part 2");
+        }
 
-    len = import("input.txt", NULL);
-    assert(len > 0);
-
-    buf = calloc(len + 1, sizeof(char));
-    import("input.txt", buf);
-    assert(buf);
-
-    printf("Score part 1: %u\n", evaluate_cards(buf, len));
-    printf("Score part 2: %u\n", evaluate_cards_part_2(buf, len));
+        line_index_free(&lines);
+        if (err) {
+            import_unmap(&view);
+            return 1;
+        }
+        import_unmap(&view);
+    } else {
+        // pipes and stdin can't be mapped so read them a line at a time
+        PROBE_BEGIN("import");
+        err = import_stream_open(path, &stream, 0);
+        PROBE_END("import");
+        assert(err == 0);
+
+        PROBE_BEGIN("stream");
+        err = evaluate_cards_stream(&stream, &score, &n_cards);
+        PROBE_END("stream");
+
+        import_stream_close(&stream);
+        if (err)
+            return 1;
+    }
 
-    free(buf);
+    printf("Score part 1: %u\n", score);
+    printf("Score part 2: %lu\n", (unsigned long)n_cards);
 
     return 0;
 }
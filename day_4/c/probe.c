@@ -0,0 +1,173 @@
+#include "probe.h"
+
+#ifdef AOC_PROBE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+// most distinct phases a run can have
+#define PROBE_PHASES 16
+
+// hardware counters read around each phase
+#define PROBE_COUNTERS 4
+
+/// @brief one phase of main and everything recorded about it
+typedef struct ProbePhase {
+    const char *name;                   ///< phase name
+    uint64_t calls;                     ///< times the phase ran
+    uint64_t wall_ns;                   ///< total wall time
+    uint64_t count[PROBE_COUNTERS];     ///< total of each counter
+    uint64_t start_ns;                  ///< wall clock at the last probe_begin
+    uint64_t start[PROBE_COUNTERS];     ///< counters at the last probe_begin
+} ProbePhase;
+
+static const char *counter_names[PROBE_COUNTERS] = {
+    "cycles",
+    "instructions",
+    "cache-misses",
+    "branch-misses",
+};
+
+static ProbePhase phases[PROBE_PHASES];
+static size_t n_phases;
+static int counter_fd[PROBE_COUNTERS] = { -1, -1, -1, -1 };
+static bool started;
+
+/// @brief nanoseconds on the monotonic clock
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/// @brief open one counter per event for this process and every thread it starts
+/// counters the kernel won't give us, in containers or under perf_event_paranoid, stay closed
+static void open_counters(void) {
+#ifdef __linux__
+    static const uint64_t events[PROBE_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    struct perf_event_attr attr;
+
+    for (size_t i = 0; i < PROBE_COUNTERS; i++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = events[i];
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        counter_fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+}
+
+/// @brief read every open counter, closed ones read as 0
+static void read_counters(uint64_t *out) {
+    for (size_t i = 0; i < PROBE_COUNTERS; i++) {
+        out[i] = 0;
+        if (counter_fd[i] >= 0 && read(counter_fd[i], &out[i], sizeof(out[i])) != sizeof(out[i]))
+            out[i] = 0;
+    }
+}
+
+/// @brief print the table of phases to stderr
+static void report(void) {
+    size_t i, j;
+
+    fprintf(stderr, "%-12s %8s %12s", "phase", "calls", "wall ms");
+    for (j = 0; j < PROBE_COUNTERS; j++)
+        fprintf(stderr, " %14s", counter_names[j]);
+    fprintf(stderr, "\n");
+
+    for (i = 0; i < n_phases; i++) {
+        fprintf(stderr, "%-12s %8lu %12.3f",
+                phases[i].name, (unsigned long)phases[i].calls, phases[i].wall_ns / 1e6);
+        for (j = 0; j < PROBE_COUNTERS; j++) {
+            if (counter_fd[j] >= 0)
+                fprintf(stderr, " %14lu", (unsigned long)phases[i].count[j]);
+            else
+                fprintf(stderr, " %14s", "n/a");
+        }
+        fprintf(stderr, "\n");
+    }
+
+    for (j = 0; j < PROBE_COUNTERS; j++) {
+        if (counter_fd[j] >= 0)
+            close(counter_fd[j]);
+    }
+}
+
+/// @brief find a phase by name, adding it on first use
+static ProbePhase *find_phase(const char *name) {
+    size_t i;
+
+    for (i = 0; i < n_phases; i++) {
+        if (phases[i].name == name || strcmp(phases[i].name, name) == 0)
+            return &phases[i];
+    }
+
+    if (n_phases == PROBE_PHASES) {
+        fprintf(stderr, "Too many probe phases, %s is not recorded!\n", name);
+        return NULL;
+    }
+
+    phases[n_phases].name = name;
+    return &phases[n_phases++];
+}
+
+void probe_begin(const char *phase) {
+    ProbePhase *p;
+
+    if (!started) {
+        open_counters();
+        atexit(report);
+        started = true;
+    }
+
+    p = find_phase(phase);
+    if (p == NULL)
+        return;
+
+    read_counters(p->start);
+    p->start_ns = now_ns();
+}
+
+void probe_end(const char *phase) {
+    uint64_t end_ns = now_ns();
+    uint64_t end[PROBE_COUNTERS];
+    ProbePhase *p = find_phase(phase);
+
+    if (p == NULL)
+        return;
+
+    read_counters(end);
+
+    p->calls++;
+    p->wall_ns += end_ns - p->start_ns;
+    for (size_t i = 0; i < PROBE_COUNTERS; i++)
+        p->count[i] += end[i] - p->start[i];
+}
+
+#else
+
+// without AOC_PROBE there is nothing to build, ISO C still wants a declaration
+typedef int probe_disabled;
+
+#endif // AOC_PROBE
@@ -0,0 +1,26 @@
+#ifndef AOC_PROBE_H
+#define AOC_PROBE_H
+
+/// @brief time a phase of main, PROBE_BEGIN and PROBE_END take the same phase name
+/// built with AOC_PROBE (make PROBE=1) every phase records wall time and, where the kernel
+/// allows it, cycles, instructions, cache misses and branch misses. A table of every phase is
+/// printed to stderr at exit. Without AOC_PROBE the macros are empty and nothing is linked in
+#ifdef AOC_PROBE
+#define PROBE_BEGIN(phase) probe_begin(phase)
+#define PROBE_END(phase) probe_end(phase)
+#else
+#define PROBE_BEGIN(phase) ((void)0)
+#define PROBE_END(phase) ((void)0)
+#endif
+
+#ifdef AOC_PROBE
+/// @brief start timing a phase, a phase may run any number of times
+/// @param phase name of the phase, a string literal
+void probe_begin(const char *phase);
+
+/// @brief stop timing a phase started by probe_begin
+/// @param phase name of the phase
+void probe_end(const char *phase);
+#endif
+
+#endif // AOC_PROBE_H
@@ -0,0 +1,24 @@
+#ifndef AOC_SCRATCHCARDS_H
+#define AOC_SCRATCHCARDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief evaluate winning state of a scratcher
+/// @param s NULL terminated string Card N: N N N | N N N N N N
+/// @return the score
+uint32_t evaluate_card(const char *s);
+
+/// @brief sum the winning scores of every card
+/// @param buf char buffer of scratcher data
+/// @param count number of chars in buf
+/// @return score
+uint32_t evaluate_cards(const char *buf, size_t count);
+
+/// @brief total number of cards once every card has won its copies
+/// @param buf char buffer of scratcher data
+/// @param count number of chars in buf
+/// @return number of cards
+uint64_t evaluate_cards_part_2(const char *buf, size_t count);
+
+#endif // AOC_SCRATCHCARDS_H
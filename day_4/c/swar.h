@@ -0,0 +1,131 @@
+#ifndef AOC_SWAR_H
+#define AOC_SWAR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// the byte tricks below read the first char of a string from the low byte of a word
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "swar.h needs a little endian target"
+#endif
+
+#define SWAR_ONES 0x0101010101010101ULL
+#define SWAR_HIGH 0x8080808080808080ULL
+
+/// @brief load up to 8 chars into a word, missing bytes are 0
+/// @param p chars to load
+/// @param n chars that may be read
+/// @return word with p[0] in the low byte
+static inline uint64_t swar_load(const char *p, size_t n) {
+    uint64_t x = 0;
+
+    memcpy(&x, p, n < 8 ? n : 8);
+    return x;
+}
+
+/// @brief mark the bytes of a word that aren't ASCII digits
+/// a byte that overflows can carry into the byte above it, so only the lowest mark is exact
+/// @param x word from swar_load
+/// @return high bit of each non digit byte set
+static inline uint64_t swar_non_digits(uint64_t x) {
+    uint64_t v = x ^ (SWAR_ONES * '0');
+
+    return ((v + SWAR_ONES * (0x80 - 10)) | v) & SWAR_HIGH;
+}
+
+/// @brief mark the bytes of a word that are neither an ASCII digit nor a space
+/// unlike swar_non_digits the marks are exact, no byte carries into the next
+/// @param x word from swar_load
+/// @param n bytes of x that were loaded, the zeros past them aren't marked
+/// @return high bit of each such byte set
+static inline uint64_t swar_non_columns(uint64_t x, size_t n) {
+    const uint64_t low = SWAR_ONES * 0x7F;
+    uint64_t digit = x ^ (SWAR_ONES * '0');
+    uint64_t space = x ^ (SWAR_ONES * ' ');
+
+    // a byte of x ^ '0' under 10 is a digit, one of x ^ ' ' that is 0 is a space
+    digit = ((digit & low) + SWAR_ONES * (0x80 - 10)) | digit;
+    space = ((space & low) + low) | space;
+    if (n < 8)
+        digit &= ((uint64_t)1 << (8 * n)) - 1;
+
+    return digit & space & SWAR_HIGH;
+}
+
+/// @brief count the leading ASCII digits of a word
+/// @param x word from swar_load
+/// @return 0 to 8
+static inline size_t swar_digit_count(uint64_t x) {
+    uint64_t mask = swar_non_digits(x);
+
+    return mask ? (size_t)__builtin_ctzll(mask) / 8 : 8;
+}
+
+/// @brief convert a word of 8 ASCII digits to its value in three multiplies
+/// @param x word from swar_load, pad short numbers with leading zeros
+/// @return value
+static inline uint32_t swar_digits8(uint64_t x) {
+    x &= SWAR_ONES * 0x0F;
+    x = (x * 10 + (x >> 8)) & 0x00FF00FF00FF00FFULL;
+    x = (x * 100 + (x >> 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x * 10000 + (x >> 32)) & 0xFFFFFFFFULL;
+
+    return (uint32_t)x;
+}
+
+/// @brief parse an unsigned number of up to 8 digits
+/// @param p first char of the number
+/// @param n chars that may be read
+/// @param val parsed value, 0 when p is not a digit
+/// @return number of digits read
+static inline size_t swar_parse_uint(const char *p, size_t n, uint32_t *val) {
+    uint64_t x = swar_load(p, n);
+    size_t digits = swar_digit_count(x);
+
+    // shift out whatever follows the number so the top bytes hold it and the rest are zeros
+    *val = digits ? swar_digits8(x << (8 * (8 - digits))) : 0;
+    return digits;
+}
+
+/// @brief parse right aligned columns of up to 8 chars with one separator char between each
+/// a space pads as 0 so every column is a fixed width number with leading zeros. Two char
+/// columns "36 15  7" are the common case and come out three to a word
+/// @param p first char of the first column
+/// @param n number of columns
+/// @param width chars per column, 1 to 8
+/// @param out value of each column, only meaningful when every column is valid
+/// @return whether every column held only digits and spaces
+static inline bool swar_parse_columns(const char *p, size_t n, size_t width, uint32_t *out) {
+    uint64_t x, bad = 0;
+    size_t i;
+
+    if (width != 2) {
+        for (i = 0; i < n; i++, p += width + 1) {
+            x = swar_load(p, width);
+            bad |= swar_non_columns(x, width);
+            out[i] = swar_digits8(x << (8 * (8 - width)));
+        }
+        return bad == 0;
+    }
+
+    for (i = 0; i < n; i += 3, p += 9) {
+        x = swar_load(p, (n - i) * 3 - 1);
+        bad |= swar_non_columns(x, (n - i) * 3 - 1);
+
+        // every byte becomes ten times itself plus the byte above
+        x &= SWAR_ONES * 0x0F;
+        x = x * 10 + (x >> 8);
+
+        out[i] = (uint8_t)x;
+        if (i + 1 < n)
+            out[i + 1] = (uint8_t)(x >> 24);
+        if (i + 2 < n)
+            out[i + 2] = (uint8_t)(x >> 48);
+    }
+
+    return bad == 0;
+}
+
+#endif // AOC_SWAR_H